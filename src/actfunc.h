@@ -17,8 +17,22 @@ public:
     virtual double computeOutput(
         const double               &input, 
         vector<shared_ptr<Neuron>> *neurons) = 0;
+    
+    // w̑SẴj[̓͂o͂߂B
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) 
+    {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = computeOutput(inputs[i], neurons);
+    }
+    
+    // output͏`dŋ߂óBo͂狁܂֐͒z֐vZȂB
     virtual double computeDifferentialOutput(
         const double               &input, 
+        const double               &output, 
         vector<shared_ptr<Neuron>> *neurons) = 0;
 };
 
@@ -33,10 +47,10 @@ public:
     
     virtual double computeDifferentialOutput(
         const double               &input, 
+        const double               &output, 
         vector<shared_ptr<Neuron>> *neurons) override 
     {
-        double o = computeOutput(input, neurons);
-        return o * negateRatio(o);
+        return output * negateRatio(output);
     }
 };
 
@@ -51,10 +65,10 @@ public:
     
     virtual double computeDifferentialOutput(
         const double               &input, 
+        const double               &output, 
         vector<shared_ptr<Neuron>> *neurons) override 
     {
-        double t = tanh(0.5 * input);
-        return 0.25 * negateRatio(t * t);
+        return output * negateRatio(output);
     }
 };
 
@@ -70,22 +84,266 @@ public:
         return exp(input) / inputExpsSum;
     }
     
+    // K͑̕wƂɈx߂B
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        double inputExpsSum = 0.0;
+        for (size_t i = 0; i < number; i++) {
+            outputs[i] = exp(inputs[i]);
+            inputExpsSum += outputs[i];
+        }
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] /= inputExpsSum;
+    }
+    
+    virtual double computeDifferentialOutput(
+        const double               &input, 
+        const double               &output, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return output * negateRatio(output);
+    }
+};
+
+// ͂̂܂܏o͂Bcompress߂ŋށAK𗎂ƂwɎgB
+class LinearFunction : public ActivationFunction {
+public:
+    virtual double computeOutput(
+        const double               &input, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return input;
+    }
+    
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        if (outputs != inputs) 
+            copy(inputs, inputs + number, outputs);
+    }
+    
+    virtual double computeDifferentialOutput(
+        const double               &input, 
+        const double               &output, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return 1.0;
+    }
+};
+
+constexpr double LEAKY_RELU_SLOPE = 0.01;
+constexpr double ELU_ALPHA        = 1.0;
+
+// ReLUn̊֐͕̖ŏAcomputeOutputs̃[vRpCxNgł悤ɂB
+class ReluFunction : public ActivationFunction {
+public:
+    virtual double computeOutput(
+        const double               &input, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return max(input, 0.0);
+    }
+    
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = max(inputs[i], 0.0);
+    }
+    
+    virtual double computeDifferentialOutput(
+        const double               &input, 
+        const double               &output, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return (double)(input > 0.0);
+    }
+};
+
+class LeakyReluFunction : public ActivationFunction {
+public:
+    virtual double computeOutput(
+        const double               &input, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return max(input, LEAKY_RELU_SLOPE * input);
+    }
+    
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = max(inputs[i], LEAKY_RELU_SLOPE * inputs[i]);
+    }
+    
+    virtual double computeDifferentialOutput(
+        const double               &input, 
+        const double               &output, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return LEAKY_RELU_SLOPE + negateRatio(LEAKY_RELU_SLOPE) * (double)(input > 0.0);
+    }
+};
+
+// ȂxAłȂELU_ALPHA * (exp(x) - 1)Bexp̈0ȉɗ}ĈȂ悤ɂB
+// ̑̔͏o + ELU_ALPHAȂ̂ŁAexpvZȂB
+class EluFunction : public ActivationFunction {
+public:
+    virtual double computeOutput(
+        const double               &input, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return max(input, 0.0) + ELU_ALPHA * (exp(min(input, 0.0)) - 1.0);
+    }
+    
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = max(inputs[i], 0.0) + ELU_ALPHA * (exp(min(inputs[i], 0.0)) - 1.0);
+    }
+    
+    virtual double computeDifferentialOutput(
+        const double               &input, 
+        const double               &output, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        double positive = (double)(input > 0.0);
+        return positive + negateRatio(positive) * (output + ELU_ALPHA);
+    }
+};
+
+// fastExpŋ߂ELUB̑̐Ό덷͍őŖ7.1e-9 * ELU_ALPHAB
+class FastEluFunction : public EluFunction {
+public:
+    virtual double computeOutput(
+        const double               &input, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return max(input, 0.0) + ELU_ALPHA * (fastExp(min(input, 0.0)) - 1.0);
+    }
+    
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = max(inputs[i], 0.0) + ELU_ALPHA * (fastExp(min(inputs[i], 0.0)) - 1.0);
+    }
+};
+
+// fastExpŋ߂VOCh֐BΌ덷͍őŖ7.1e-9B
+class FastSigmoidFunction : public ActivationFunction {
+public:
+    virtual double computeOutput(
+        const double               &input, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return invert(1.0 + fastExp(-input));
+    }
+    
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = invert(1.0 + fastExp(-inputs[i]));
+    }
+    
+    virtual double computeDifferentialOutput(
+        const double               &input, 
+        const double               &output, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        return output * negateRatio(output);
+    }
+};
+
+// 0.5 * (1 + tanh(0.5 * x))1 / (1 + exp(-x))ɓ̂ŁAVOCh֐ƓߎgB
+// 0.25 * (1 - tanh(0.5 * x)^2)o * (1 - o)ɓB
+class FastTanhFunction : public FastSigmoidFunction {};
+
+// fastExpŋ߂\tg}bNX֐BΌ덷͍őŖ1.5e-8B
+class FastSoftmaxFunction : public ActivationFunction {
+public:
+    virtual double computeOutput(
+        const double               &input, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        double inputExpsSum = 0.0;
+        for (auto n : *neurons) 
+            inputExpsSum += fastExp(n->getInput());
+        return fastExp(input) / inputExpsSum;
+    }
+    
+    virtual void computeOutputs(
+        const double               *inputs, 
+        double                     *outputs, 
+        const size_t               &number, 
+        vector<shared_ptr<Neuron>> *neurons) override 
+    {
+        double inputExpsSum = 0.0;
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = fastExp(inputs[i]);
+        for (size_t i = 0; i < number; i++) 
+            inputExpsSum += outputs[i];
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] /= inputExpsSum;
+    }
+    
     virtual double computeDifferentialOutput(
         const double               &input, 
+        const double               &output, 
         vector<shared_ptr<Neuron>> *neurons) override 
     {
-        double o = computeOutput(input, neurons);
-        return o * negateRatio(o);
+        return output * negateRatio(output);
     }
 };
 
 inline const map<string, shared_ptr<ActivationFunction>> *getActivationFunctions() {
     static const map<string, shared_ptr<ActivationFunction>> ACTIVATION_FUNCTIONS = {
-        {"sigmoid", newInstance<SigmoidFunction>()}, 
-        {"tanh",    newInstance<TanhFunction>()}, 
-        {"softmax", newInstance<SoftmaxFunction>()}, 
+        {"sigmoid",   newInstance<SigmoidFunction>()}, 
+        {"tanh",      newInstance<TanhFunction>()}, 
+        {"softmax",   newInstance<SoftmaxFunction>()}, 
+        {"relu",      newInstance<ReluFunction>()}, 
+        {"leakyRelu", newInstance<LeakyReluFunction>()}, 
+        {"elu",       newInstance<EluFunction>()}, 
+        {"linear",    newInstance<LinearFunction>()}, 
     };
     return &ACTIVATION_FUNCTIONS;
 }
 
+// fastMatĥƂɎg֐Bߎ̖֐getActivationFunctionsƓB
+inline const map<string, shared_ptr<ActivationFunction>> *getFastActivationFunctions() {
+    static const map<string, shared_ptr<ActivationFunction>> FAST_ACTIVATION_FUNCTIONS = []() {
+        auto functions = *getActivationFunctions();
+        functions["sigmoid"] = newInstance<FastSigmoidFunction>();
+        functions["tanh"]    = newInstance<FastTanhFunction>();
+        functions["softmax"] = newInstance<FastSoftmaxFunction>();
+        functions["elu"]     = newInstance<FastEluFunction>();
+        return functions;
+    }();
+    return &FAST_ACTIVATION_FUNCTIONS;
+}
+
 #endif
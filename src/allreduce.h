@@ -0,0 +1,366 @@
+#ifndef ALLREDUCE_H
+#define ALLREDUCE_H
+
+#include "help.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// L̒ʐMHňxɓndouble̐B傫Ȕz͕ēnB
+constexpr size_t SHARED_MEMORY_RING_CAPACITY = 1 << 16;
+
+// L̒ʐMHő҂ƂɁȀʂ̃vZXĂ邩𒲂ׂ̉񐔁B
+constexpr size_t SHARED_MEMORY_RING_CHECK_INTERVAL = 1 << 10;
+
+// ׂ̗̏ʂƂ̒ʐMHBsend͎̏ʂ֑Areceive͑Ȍʂ󂯎B
+class RingTransport {
+public:
+    virtual ~RingTransport() {}
+    virtual void send(const double *values, const size_t &number) = 0;
+    virtual void receive(double *values, const size_t &number) = 0;
+};
+
+// ɕ񂾃vZXŔz̘a߂B
+// zʂ̐̕ɕAreduce-scatterallgatherłꂼꏇʂ̐ - 1񂸂ׂƕB
+// Ƃ̘a1̏ʂŋ߂ĔẑŁASĂ̏ʂœlɂȂB
+class RingAllreducer {
+protected:
+    size_t                    rank;
+    size_t                    ranksNumber;
+    shared_ptr<RingTransport> transport;
+    vector<double>            receivedValues;
+    vector<int>               children;
+    
+    size_t getPartBegin(const size_t &part, const size_t &number) 
+        { return part * number / this->ranksNumber; }
+    
+    // ̏ʂ͑Ă󂯎A̏ʂ͎󂯎Ă瑗B
+    // SĂ̏ʂɑ낤ƂāAʐMH̋󂫂҂Ƃ悤ɂB
+    void exchange(
+        const double *sentValues, 
+        const size_t &sentNumber, 
+        double       *receivedValues, 
+        const size_t &receivedNumber) 
+    {
+        if (this->rank % 2 == 0) {
+            this->transport->send(sentValues, sentNumber);
+            this->transport->receive(receivedValues, receivedNumber);
+        } else {
+            this->transport->receive(receivedValues, receivedNumber);
+            this->transport->send(sentValues, sentNumber);
+        }
+    }
+public:
+    RingAllreducer(
+        const size_t                    &rank, 
+        const size_t                    &ranksNumber, 
+        const shared_ptr<RingTransport> &transport, 
+        const vector<int>               &children) : 
+            rank       (rank), 
+            ranksNumber(ranksNumber), 
+            transport  (transport), 
+            children   (children) {}
+    
+    size_t getRank() 
+        { return this->rank; }
+    size_t getRanksNumber() 
+        { return this->ranksNumber; }
+    
+    // SĂ̏ʂnumberŌĂ΂Ȃ΂ȂȂB
+    void allreduce(double *values, const size_t &number) {
+        this->receivedValues.resize(max(this->receivedValues.size(), number / this->ranksNumber + 1));
+        for (size_t s = 0; s + 1 < this->ranksNumber; s++) {
+            size_t sentPart = (this->rank + this->ranksNumber - s) % this->ranksNumber;
+            size_t receivedPart = (this->rank + this->ranksNumber - s - 1) % this->ranksNumber;
+            size_t sentBegin = getPartBegin(sentPart, number);
+            size_t receivedBegin = getPartBegin(receivedPart, number);
+            size_t receivedNumber = getPartBegin(receivedPart + 1, number) - receivedBegin;
+            exchange(
+                values + sentBegin, 
+                getPartBegin(sentPart + 1, number) - sentBegin, 
+                &this->receivedValues[0], 
+                receivedNumber);
+            for (size_t i = 0; i < receivedNumber; i++) 
+                values[receivedBegin + i] += this->receivedValues[i];
+        }
+        for (size_t s = 0; s + 1 < this->ranksNumber; s++) {
+            size_t sentPart = (this->rank + 1 + this->ranksNumber - s) % this->ranksNumber;
+            size_t receivedPart = (this->rank + this->ranksNumber - s) % this->ranksNumber;
+            size_t sentBegin = getPartBegin(sentPart, number);
+            size_t receivedBegin = getPartBegin(receivedPart, number);
+            exchange(
+                values + sentBegin, 
+                getPartBegin(sentPart + 1, number) - sentBegin, 
+                values + receivedBegin, 
+                getPartBegin(receivedPart + 1, number) - receivedBegin);
+        }
+    }
+    
+    // 0ŁAqvZXSďÎ҂BsqvZXΗO𓊂B
+    void waitChildren() {
+#ifndef _WIN32
+        bool failed = false;
+        for (auto pid : this->children) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) 
+                failed = true;
+        }
+        this->children.clear();
+        if (failed) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "P̎qvZXs܂B");
+#endif
+    }
+};
+
+#ifndef _WIN32
+
+// L̒ʐMHBʂƂɎ̏ʂւ1̘gAƎ󂯎ŋ󂫂mB
+// fork̑OɍASĂ̏ʂœʑgB
+class SharedMemoryRing {
+protected:
+    struct Slot {
+        atomic<uint64_t> sentNumber;
+        atomic<uint64_t> receivedNumber;
+        double           values[SHARED_MEMORY_RING_CAPACITY];
+    };
+    
+    Slot        *slots;
+    size_t       ranksNumber;
+    pid_t        parentPid;
+    vector<int>  children;
+    
+    // 0ł͎qvZX̂ǂꂩAqvZXł͐eIĂfalseB
+    // qvZX̏IԂ͎cAwaitChildrenŉB
+    bool arePeersAlive() {
+        if (getpid() != this->parentPid) 
+            return getppid() == this->parentPid;
+        for (auto pid : this->children) {
+            siginfo_t info = {};
+            if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == pid) 
+                return false;
+        }
+        return true;
+    }
+    
+    // ̏ʂ̃vZXOُŏIA܂ł҂ɗO𓊂B
+    template <typename Ready> 
+    void waitUntil(const Ready &ready) {
+        for (size_t i = 1; !ready(); i++) {
+            if (i % SHARED_MEMORY_RING_CHECK_INTERVAL == 0 && !arePeersAlive() && !ready()) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "̏ʂ̃vZXI܂B");
+            this_thread::yield();
+        }
+    }
+public:
+    SharedMemoryRing(const size_t &ranksNumber) : 
+        ranksNumber(ranksNumber), 
+        parentPid  (getpid()) 
+    {
+        void *p = mmap(nullptr, sizeof(Slot) * ranksNumber, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "Lmۂł܂B");
+        this->slots = (Slot *)p;
+        for (size_t r = 0; r < ranksNumber; r++) {
+            new(&this->slots[r].sentNumber) atomic<uint64_t>(0);
+            new(&this->slots[r].receivedNumber) atomic<uint64_t>(0);
+        }
+    }
+    
+    SharedMemoryRing(const SharedMemoryRing &) = delete;
+    SharedMemoryRing &operator=(const SharedMemoryRing &) = delete;
+    
+    ~SharedMemoryRing() {
+        munmap(this->slots, sizeof(Slot) * this->ranksNumber);
+    }
+    
+    // forkA0ŎqvZXB
+    void setChildren(const vector<int> &children) 
+        { this->children = children; }
+    
+    void send(const size_t &rank, const double *values, const size_t &number) {
+        auto slot = &this->slots[rank];
+        for (size_t offset = 0; offset < number; offset += SHARED_MEMORY_RING_CAPACITY) {
+            waitUntil([slot]() {
+                return slot->receivedNumber.load(memory_order_acquire) == slot->sentNumber.load(memory_order_relaxed);
+            });
+            memcpy(slot->values, values + offset, sizeof(double) * min(SHARED_MEMORY_RING_CAPACITY, number - offset));
+            slot->sentNumber.fetch_add(1, memory_order_release);
+        }
+    }
+    
+    void receive(const size_t &rank, double *values, const size_t &number) {
+        auto slot = &this->slots[(rank + this->ranksNumber - 1) % this->ranksNumber];
+        for (size_t offset = 0; offset < number; offset += SHARED_MEMORY_RING_CAPACITY) {
+            waitUntil([slot]() {
+                return slot->sentNumber.load(memory_order_acquire) != slot->receivedNumber.load(memory_order_relaxed);
+            });
+            memcpy(values + offset, slot->values, sizeof(double) * min(SHARED_MEMORY_RING_CAPACITY, number - offset));
+            slot->receivedNumber.fetch_add(1, memory_order_release);
+        }
+    }
+};
+
+class SharedMemoryTransport : public RingTransport {
+protected:
+    shared_ptr<SharedMemoryRing> ring;
+    size_t                       rank;
+public:
+    SharedMemoryTransport(const shared_ptr<SharedMemoryRing> &ring, const size_t &rank) : 
+        ring(ring), 
+        rank(rank) {}
+    
+    virtual void send(const double *values, const size_t &number) override 
+        { this->ring->send(this->rank, values, number); }
+    virtual void receive(double *values, const size_t &number) override 
+        { this->ring->receive(this->rank, values, number); }
+};
+
+// [vobNTCP̒ʐMHBlbg[Nz̒ʐM̑B
+// ҂󂯂\Pbgfork̑OɑSĂ̏ʂ̂̕ŁAڑ悪܂҂󂯂ĂȂƂ͖B
+class TcpTransport : public RingTransport {
+protected:
+    int nextFd;
+    int previousFd;
+public:
+    TcpTransport(const size_t &rank, const vector<int> &listenFds, const vector<uint16_t> &ports) : 
+        nextFd    (-1), 
+        previousFd(-1) 
+    {
+        size_t nextRank = (rank + 1) % listenFds.size();
+        this->nextFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(ports[nextRank]);
+        if (this->nextFd < 0 || 
+            connect(this->nextFd, (sockaddr *)&address, sizeof(address)) != 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "̏ʂɐڑł܂B");
+        this->previousFd = accept(listenFds[rank], nullptr, nullptr);
+        if (this->previousFd < 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "Ȍʂ̐ڑ󂯕t܂B");
+        for (auto fd : listenFds) 
+            close(fd);
+        int noDelay = 1;
+        setsockopt(this->nextFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+    
+    TcpTransport(const TcpTransport &) = delete;
+    TcpTransport &operator=(const TcpTransport &) = delete;
+    
+    ~TcpTransport() {
+        if (this->nextFd >= 0) 
+            close(this->nextFd);
+        if (this->previousFd >= 0) 
+            close(this->previousFd);
+    }
+    
+    virtual void send(const double *values, const size_t &number) override {
+        auto data = (const char *)values;
+        size_t size = sizeof(double) * number;
+        for (size_t sentSize = 0; sentSize < size;) {
+            ssize_t n = ::send(this->nextFd, data + sentSize, size - sentSize, MSG_NOSIGNAL);
+            if (n <= 0) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "̏ʂɑ܂B");
+            sentSize += n;
+        }
+    }
+    
+    virtual void receive(double *values, const size_t &number) override {
+        auto data = (char *)values;
+        size_t size = sizeof(double) * number;
+        for (size_t receivedSize = 0; receivedSize < size;) {
+            ssize_t n = recv(this->previousFd, data + receivedSize, size - receivedSize, 0);
+            if (n <= 0) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "Ȍʂ󂯎܂B");
+            receivedSize += n;
+        }
+    }
+};
+
+#endif
+
+inline const vector<string> *getRingTransportNames() {
+    static const vector<string> RING_TRANSPORT_NAMES = {"shm", "tcp"};
+    return &RING_TRANSPORT_NAMES;
+}
+
+// ranksNumber̃vZX̊BĂяovZX0ɂȂAc̏ʂ͎qvZXforkčB
+// qvZXfork̑Õʂňp̂ŁAfork̓XbhOɌĂ΂Ȃ΂ȂȂB
+// ranksNumber1Ȃ炸nullptrԂB
+inline shared_ptr<RingAllreducer> forkRing(const size_t &ranksNumber, const string &transportName) {
+    if (find(getRingTransportNames()->begin(), getRingTransportNames()->end(), transportName) == 
+        getRingTransportNames()->end()) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'", transportName, "'ƂʐMH͂܂B");
+    if (ranksNumber == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "vZX̐1ȏłȂ΂Ȃ܂B");
+    if (ranksNumber == 1) 
+        return nullptr;
+#ifndef _WIN32
+    shared_ptr<SharedMemoryRing> sharedMemoryRing;
+    vector<int> listenFds;
+    vector<uint16_t> ports;
+    if (transportName == "shm") {
+        sharedMemoryRing = newInstance<SharedMemoryRing>(ranksNumber);
+    } else {
+        for (size_t r = 0; r < ranksNumber; r++) {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = 0;
+            socklen_t addressSize = sizeof(address);
+            if (fd < 0 || 
+                bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || 
+                listen(fd, 1) != 0 || 
+                getsockname(fd, (sockaddr *)&address, &addressSize) != 0) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "[vobNő҂󂯂܂B");
+            listenFds.push_back(fd);
+            ports.push_back(ntohs(address.sin_port));
+        }
+    }
+    cout.flush();
+    cerr.flush();
+    size_t rank = 0;
+    vector<int> children;
+    for (size_t r = 1; r < ranksNumber; r++) {
+        pid_t pid = fork();
+        if (pid < 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "qvZX܂B");
+        if (pid == 0) {
+            rank = r;
+            children.clear();
+            break;
+        }
+        children.push_back(pid);
+    }
+    shared_ptr<RingTransport> transport;
+    if (sharedMemoryRing) {
+        sharedMemoryRing->setChildren(children);
+        transport = newInstance<SharedMemoryTransport>(sharedMemoryRing, rank);
+    } else {
+        transport = newInstance<TcpTransport>(rank, listenFds, ports);
+    }
+    return newInstance<RingAllreducer>(rank, ranksNumber, transport, children);
+#else
+    throw describe(__FILE__, "(", __LINE__, "): " , "̊ł͕̃vZXŌPł܂B");
+#endif
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "help.h"
+#include "pages.h"
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t ARENA_ALIGNMENT = 64;
+
+// operator new̌Ăяo񐔁Bnnetoperator newuĐB
+inline atomic<size_t> *getHeapAllocationsNumber() {
+    static atomic<size_t> HEAP_ALLOCATIONS_NUMBER(0);
+    return &HEAP_ALLOCATIONS_NUMBER;
+}
+
+// lbg[N̍\zɑ傫߂Ĉxmۂ̈B
+// p[^ƌzƊ̔zAj[ɒuB
+// 傫ȃA[ihugePagesݒɏ]đ傫ȃy[WɒuB
+class Arena {
+protected:
+    PageMemory                              memory;
+    char                                   *base;
+    size_t                                  capacity;
+    size_t                                  used;
+    vector<pair<void (*)(void *), void *>>  destructors;
+    
+    static size_t alignUp(const size_t &size, const size_t &alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+    
+    void *allocate(const size_t &size, const size_t &alignment) {
+        size_t offset = alignUp(this->used, alignment);
+        if (offset + size > this->capacity) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "A[i̗eʂ܂B");
+        this->used = offset + size;
+        return this->base + offset;
+    }
+    
+    template <typename Type> 
+    static void destroy(void *object) {
+        static_cast<Type *>(object)->~Type();
+    }
+public:
+    Arena(const size_t &capacity) : 
+        memory  (capacity), 
+        base    (memory.getData()), 
+        capacity(capacity), 
+        used    (0) {}
+    
+    ~Arena() {
+        for (auto d = this->destructors.rbegin(); d != this->destructors.rend(); d++) 
+            d->first(d->second);
+    }
+    
+    size_t getCapacity() 
+        { return this->capacity; }
+    size_t getUsed() 
+        { return this->used; }
+    
+    template <typename Type> 
+    static size_t computeArraySize(const size_t &number) {
+        return alignUp(sizeof(Type) * number, ARENA_ALIGNMENT) + ARENA_ALIGNMENT;
+    }
+    
+    template <typename Type> 
+    static size_t computeObjectsSize(const size_t &number) {
+        return alignUp(sizeof(Type), alignof(Type)) * number + alignof(Type);
+    }
+    
+    template <typename Type> 
+    Type *allocateArray(const size_t &number) {
+        return static_cast<Type *>(allocate(sizeof(Type) * number, ARENA_ALIGNMENT));
+    }
+    
+    template <typename Type, typename ...Arguments> 
+    Type *create(Arguments&&... arguments) {
+        Type *object = new(allocate(sizeof(Type), alignof(Type))) 
+            Type(static_cast<Arguments&&>(arguments)...);
+        if (!is_trivially_destructible<Type>::value) 
+            this->destructors.push_back(make_pair(&destroy<Type>, (void *)object));
+        return object;
+    }
+};
+
+// A[iɒuIuWFNgwL̖shared_ptrԂB
+// ̓A[iǗB
+template <typename Type, typename ...Arguments> 
+shared_ptr<Type> newArenaInstance(Arena *arena, Arguments&&... arguments) {
+    return shared_ptr<Type>(
+        shared_ptr<Type>(), 
+        arena->create<Type>(static_cast<Arguments&&>(arguments)...));
+}
+
+#endif
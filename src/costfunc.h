@@ -44,6 +44,7 @@ public:
         return (neuron->getOutput() - desiredOutput) * 
             activationFunction->computeDifferentialOutput(
                 neuron->getInput(), 
+                neuron->getOutput(), 
                 neurons);
     }
 };
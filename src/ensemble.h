@@ -0,0 +1,136 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "help.h"
+#include "mnist.h"
+#include "network.h"
+#include <algorithm>
+#include <istream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// ATu̒`ǂݍ݁A'lbg[Ñt@C p[^̃t@C'̑gׂB
+// 󔒍s'#'Ŏn܂s͖B
+inline vector<pair<string, string>> readEnsembleModels(istream &is) {
+    vector<pair<string, string>> models;
+    string line;
+    while (getLineAndChopCR(is, line)) {
+        if (line.empty() || 
+            line.at(0) == '#') 
+            continue;
+        vector<string> tokens;
+        tokenize(line, " \t", true, [&tokens](const string &token) {
+            tokens.push_back(token);
+        });
+        if (tokens.empty()) 
+            continue;
+        if (tokens.size() != 2) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'", line, "'̓lbg[Nƃp[^̃t@C̑gł͂܂B");
+        models.push_back(make_pair(tokens[0], tokens[1]));
+    }
+    if (models.empty()) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "ATũf܂B");
+    return models;
+}
+
+// ̃lbg[Nœ摜𑱂Đ肵Ao͂gݍ킹ē߂B
+// 摜ƂɑSẴf𐄒肷̂ŁA摜̓f̊ԂŃLbVɍڂ܂܎gB
+// meanȂo͂̕ρAvoteȂef̓̓[gݍ킹o͂ƂB
+// voteœ[񂾂o͂̕ς̑傫𓚂ƂB
+class Ensemble {
+protected:
+    vector<shared_ptr<Network>> networks;
+    shared_ptr<Log>             log;
+    bool                        votes;
+    size_t                      inferScoresNumber;
+    bool                        sortsInferScores;
+public:
+    Ensemble(
+        const vector<shared_ptr<Network>> &networks, 
+        const shared_ptr<Log>             &log, 
+        const bool                        &votes) : 
+            networks         (networks), 
+            log              (log), 
+            votes            (votes), 
+            inferScoresNumber(0), 
+            sortsInferScores (false) {}
+    
+    void setInferScores(const size_t &scoresNumber, const bool &sorted) {
+        if (scoresNumber > LABEL_VALUES_NUMBER) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "o͂̐", LABEL_VALUES_NUMBER, "ȉłȂ΂Ȃ܂B");
+        this->inferScoresNumber = scoresNumber;
+        this->sortsInferScores  = sorted;
+    }
+    
+    // fƂdoneInferModelAATudoneInferImagedoneInfero͂B
+    // ATũRXg̓f̃RXg̕ρB
+    void infer(
+        MNIST        *mnist, 
+        const size_t &imagesOffset, 
+        const size_t &imagesNumber) 
+    {
+        size_t modelsNumber = this->networks.size();
+        vector<size_t> correctAnswersNumbers(modelsNumber, 0);
+        vector<double> costsSums(modelsNumber, 0.0);
+        size_t correctAnswersNumber = 0;
+        double scores[LABEL_VALUES_NUMBER];
+        double sums[LABEL_VALUES_NUMBER];
+        double combined[LABEL_VALUES_NUMBER];
+        size_t firstAllocationsNumber = 0;
+        for (auto i = 0; i < imagesNumber; i++) {
+            if (i == 1) 
+                firstAllocationsNumber = getHeapAllocationsNumber()->load();
+            auto image = (*mnist)[imagesOffset + i].get();
+            size_t label = image->getLabel();
+            fill(sums, sums + LABEL_VALUES_NUMBER, 0.0);
+            fill(combined, combined + LABEL_VALUES_NUMBER, 0.0);
+            for (size_t m = 0; m < modelsNumber; m++) {
+                size_t answer = this->networks[m]->inferImage(image, scores, &costsSums[m]);
+                if (answer == label) 
+                    correctAnswersNumbers[m]++;
+                for (size_t j = 0; j < LABEL_VALUES_NUMBER; j++) 
+                    sums[j] += scores[j];
+                if (this->votes) 
+                    combined[answer] += 1.0;
+            }
+            if (!this->votes) 
+                copy(sums, sums + LABEL_VALUES_NUMBER, combined);
+            size_t answer = 0;
+            for (size_t j = 1; j < LABEL_VALUES_NUMBER; j++) {
+                if (combined[j] > combined[answer] || 
+                    (combined[j] == combined[answer] && sums[j] > sums[answer])) 
+                    answer = j;
+            }
+            if (answer == label) 
+                correctAnswersNumber++;
+            this->log->doneInferImage(i, image->getIndex(), label, answer);
+            if (this->inferScoresNumber != 0) {
+                for (size_t j = 0; j < LABEL_VALUES_NUMBER; j++) 
+                    combined[j] /= (double)modelsNumber;
+                putInferScores(
+                    this->log.get(), 
+                    i, 
+                    image->getIndex(), 
+                    combined, 
+                    this->inferScoresNumber, 
+                    this->sortsInferScores);
+            }
+        }
+        double costsAverageSum = 0.0;
+        for (size_t m = 0; m < modelsNumber; m++) {
+            double costsAverage = 
+                (costsSums[m] + this->networks[m]->computeWeightsCost()) / (double)imagesNumber;
+            this->log->doneInferModel(m, correctAnswersNumbers[m], costsAverage);
+            costsAverageSum += costsAverage;
+        }
+        this->log->doneInfer(correctAnswersNumber, costsAverageSum / (double)modelsNumber);
+        this->log->doneCountAllocations(
+            getHeapAllocationsNumber()->load() - firstAllocationsNumber);
+    }
+};
+
+#endif
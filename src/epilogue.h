@@ -0,0 +1,206 @@
+#ifndef EPILOGUE_H
+#define EPILOGUE_H
+
+#include "actfunc.h"
+#include "costfunc.h"
+#include "help.h"
+#include <cmath>
+#include <memory>
+
+using namespace std;
+
+inline double getDesiredOutput(const size_t &index, const size_t &label) {
+    return index == label ? 1.0 : 0.0;
+}
+
+// o͑w̓͂AóARXgAo͑w̌덷A߂B
+// errorsnullptrȂ덷͋߂ȂB͏o͂ő̃xŁARXgcostsSumɑB
+class OutputEpilogue {
+public:
+    virtual size_t run(
+        const double *inputs, 
+        double       *outputs, 
+        double       *errors, 
+        const size_t &number, 
+        const size_t &label, 
+        double       *costsSum) = 0;
+};
+
+// ֐̏o͂ƁAo͂狁߂B
+// vZ̏actfunc.h̊eNXƓɂāAʂςȂB
+struct SigmoidOutputs {
+    static void computeOutputs(const double *inputs, double *outputs, const size_t &number) {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = invert(1.0 + exp(-inputs[i]));
+    }
+    static double computeDifferentialOutput(const double &input, const double &output) {
+        return output * negateRatio(output);
+    }
+};
+
+struct TanhOutputs {
+    static void computeOutputs(const double *inputs, double *outputs, const size_t &number) {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = 0.5 * (1.0 + tanh(0.5 * inputs[i]));
+    }
+    static double computeDifferentialOutput(const double &input, const double &output) {
+        return output * negateRatio(output);
+    }
+};
+
+// K͑̕wƂɈx߂B
+struct SoftmaxOutputs {
+    static void computeOutputs(const double *inputs, double *outputs, const size_t &number) {
+        double inputExpsSum = 0.0;
+        for (size_t i = 0; i < number; i++) {
+            outputs[i] = exp(inputs[i]);
+            inputExpsSum += outputs[i];
+        }
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] /= inputExpsSum;
+    }
+    static double computeDifferentialOutput(const double &input, const double &output) {
+        return output * negateRatio(output);
+    }
+};
+
+// fastMatĥƂ̋ߎBFastTanhFunctionVOCh֐ƓߎgB
+struct FastSigmoidOutputs {
+    static void computeOutputs(const double *inputs, double *outputs, const size_t &number) {
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = invert(1.0 + fastExp(-inputs[i]));
+    }
+    static double computeDifferentialOutput(const double &input, const double &output) {
+        return output * negateRatio(output);
+    }
+};
+
+struct FastSoftmaxOutputs {
+    static void computeOutputs(const double *inputs, double *outputs, const size_t &number) {
+        double inputExpsSum = 0.0;
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] = fastExp(inputs[i]);
+        for (size_t i = 0; i < number; i++) 
+            inputExpsSum += outputs[i];
+        for (size_t i = 0; i < number; i++) 
+            outputs[i] /= inputExpsSum;
+    }
+    static double computeDifferentialOutput(const double &input, const double &output) {
+        return output * negateRatio(output);
+    }
+};
+
+// ꉻ̖֐͉z֐ŋ߂Bo͑ẘ֐̓j[gȂB
+struct VirtualOutputs {
+    ActivationFunction *activationFunction;
+    
+    void computeOutputs(const double *inputs, double *outputs, const size_t &number) const {
+        this->activationFunction->computeOutputs(inputs, outputs, number, nullptr);
+    }
+    double computeDifferentialOutput(const double &input, const double &output) const {
+        return this->activationFunction->computeDifferentialOutput(input, output, nullptr);
+    }
+};
+
+// RXg֐̃RXgƁAo͑w̌덷B
+struct QuadraticCosts {
+    static double computeCost(const double &output, const double &desiredOutput) {
+        double error = output - desiredOutput;
+        return 0.5 * error * error;
+    }
+    template <typename Outputs> 
+    static double computeError(
+        const Outputs &outputs, 
+        const double  &input, 
+        const double  &output, 
+        const double  &desiredOutput) 
+    {
+        return (output - desiredOutput) * outputs.computeDifferentialOutput(input, output);
+    }
+};
+
+struct CrossEntropyCosts {
+    static double computeCost(const double &output, const double &desiredOutput) {
+        return -(
+            desiredOutput              * log(output)              + 
+            negateRatio(desiredOutput) * log(negateRatio(output)) 
+        );
+    }
+    template <typename Outputs> 
+    static double computeError(
+        const Outputs &outputs, 
+        const double  &input, 
+        const double  &output, 
+        const double  &desiredOutput) 
+    {
+        return output - desiredOutput;
+    }
+};
+
+// o͂߂AARXgA덷1x̑ŋ߂B
+// VirtualOutputŝƂȊO͉z֐Ă΂ȂB
+template <typename Outputs, typename Costs> 
+class FusedOutputEpilogue : public OutputEpilogue {
+protected:
+    Outputs outputFunction;
+public:
+    FusedOutputEpilogue(const Outputs &outputFunction) : 
+        outputFunction(outputFunction) {}
+    
+    virtual size_t run(
+        const double *inputs, 
+        double       *outputs, 
+        double       *errors, 
+        const size_t &number, 
+        const size_t &label, 
+        double       *costsSum) override 
+    {
+        this->outputFunction.computeOutputs(inputs, outputs, number);
+        size_t answer = 0;
+        double maxOutput = 0.0;
+        for (size_t i = 0; i < number; i++) {
+            double desiredOutput = getDesiredOutput(i, label);
+            if (outputs[i] > maxOutput) {
+                answer = i;
+                maxOutput = outputs[i];
+            }
+            *costsSum += Costs::computeCost(outputs[i], desiredOutput);
+            if (errors) 
+                errors[i] = Costs::computeError(this->outputFunction, inputs[i], outputs[i], desiredOutput);
+        }
+        return answer;
+    }
+};
+
+template <typename Outputs> 
+shared_ptr<OutputEpilogue> newFusedOutputEpilogue(
+    const Outputs &outputFunction, 
+    CostFunction  *costFunction) 
+{
+    if (dynamic_cast<QuadraticFunction *>(costFunction)) 
+        return newInstance<FusedOutputEpilogue<Outputs, QuadraticCosts>>(outputFunction);
+    if (dynamic_cast<CrossEntropyFunction *>(costFunction)) 
+        return newInstance<FusedOutputEpilogue<Outputs, CrossEntropyCosts>>(outputFunction);
+    throw describe(__FILE__, "(", __LINE__, "): " , "RXg֐ɑΉ鏈܂B");
+}
+
+// ֐ƃRXg֐̑gݍ킹ɓꉻԂB
+// ꉻ̖֐Ȃ犈֐̉z֐ĂԏԂB
+inline shared_ptr<OutputEpilogue> newOutputEpilogue(
+    ActivationFunction *activationFunction, 
+    CostFunction       *costFunction) 
+{
+    if (dynamic_cast<SigmoidFunction *>(activationFunction)) 
+        return newFusedOutputEpilogue(SigmoidOutputs(), costFunction);
+    if (dynamic_cast<TanhFunction *>(activationFunction)) 
+        return newFusedOutputEpilogue(TanhOutputs(), costFunction);
+    if (dynamic_cast<SoftmaxFunction *>(activationFunction)) 
+        return newFusedOutputEpilogue(SoftmaxOutputs(), costFunction);
+    if (dynamic_cast<FastSigmoidFunction *>(activationFunction)) 
+        return newFusedOutputEpilogue(FastSigmoidOutputs(), costFunction);
+    if (dynamic_cast<FastSoftmaxFunction *>(activationFunction)) 
+        return newFusedOutputEpilogue(FastSoftmaxOutputs(), costFunction);
+    return newFusedOutputEpilogue(VirtualOutputs{activationFunction}, costFunction);
+}
+
+#endif
@@ -1,17 +1,24 @@
 #ifndef HELP_H
 #define HELP_H
 
+#include "pool.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
-#include <random>
 #include <sstream>
 #include <string>
 #include <sys/stat.h>
 #include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -112,29 +119,6 @@ void setConfig(
     }
 }
 
-class Random {
-protected:
-    mt19937 engine;
-    
-    Random() : 
-        engine(chrono::system_clock::now().time_since_epoch().count()) {}
-public:
-    template <typename Type> 
-    Type normalDistribution(const Type &a, const Type &b) {
-        return normal_distribution<>(a, b)(this->engine);
-    }
-    
-    template <typename Type> 
-    Type uniformDistribution(const Type &a, const Type &b) {
-        return uniform_int_distribution<>(a, b)(this->engine);
-    }
-    
-    static Random *getInstance() {
-        static Random INSTANCE;
-        return &INSTANCE;
-    }
-};
-
 inline void tokenize(
     const string           &str, 
     const string           &delimiters, 
@@ -189,6 +173,30 @@ inline double invert(const double &d) {
     return 1.0 / d;
 }
 
+// exp(x)̋ߎBx = n * log(2) + r (|r| <= log(2) / 2)ɕAexp(r)7̃eC[ŋ߂2^n|B
+// Ό덷͍őŖ5.3e-9Bx-708709͈̔͂Ɋۂ߂B
+// CǔĂяôŁA[v̒ł̓RpCxNgłB
+inline double fastExp(const double &x) {
+    const double LOG2E       = 1.4426950408889634074;
+    const double LN2_HI      = 6.93147180369123816490e-01;
+    const double LN2_LO      = 1.90821492927058770002e-10;
+    const double ROUND_MAGIC = 6755399441055744.0;  // 1.5 * 2^52 
+    double c = min(max(x, -708.0), 709.0);
+    double t = c * LOG2E + ROUND_MAGIC;
+    double n = t - ROUND_MAGIC;
+    double r = (c - n * LN2_HI) - n * LN2_LO;
+    double p = 1.0 + r * (1.0 + r * (1.0 / 2.0 + r * (1.0 / 6.0 + r * (1.0 / 24.0 + 
+        r * (1.0 / 120.0 + r * (1.0 / 720.0 + r * (1.0 / 5040.0)))))));
+    int64_t tBits;
+    int64_t magicBits;
+    memcpy(&tBits, &t, sizeof(double));
+    memcpy(&magicBits, &ROUND_MAGIC, sizeof(double));
+    int64_t scaleBits = (tBits - magicBits + 1023) << 52;
+    double scale;
+    memcpy(&scale, &scaleBits, sizeof(double));
+    return p * scale;
+}
+
 inline double sign(const double &d) {
     double s = 0.0;
     if (d > 0.0) 
@@ -198,4 +206,216 @@ inline double sign(const double &d) {
     return s;
 }
 
+// ĂяoXbhrunInParallelŎgXbh̍ő吔B0ȂXbhv[̃XbhB
+inline size_t *getThreadsBudget() {
+    static thread_local size_t THREADS_BUDGET = 0;
+    return &THREADS_BUDGET;
+}
+
+template <typename Run> 
+void runInParallel(
+    const size_t &size, 
+    const size_t &minPartSize, 
+    Run           run) 
+{
+    size_t threadsNumber = min<size_t>(
+        *getThreadsBudget() != 0 ? 
+            *getThreadsBudget() : 
+            getThreadPool()->getThreadsNumber(), 
+        (size + minPartSize - 1) / minPartSize);
+    if (threadsNumber <= 1) {
+        run(0, size);
+        return;
+    }
+    getThreadPool()->parallelFor(size, threadsNumber, run);
+}
+
+constexpr double PI = 3.14159265358979323846;
+
+constexpr size_t PHILOX_BLOCK_SIZE              = 4;
+constexpr size_t PHILOX_ROUNDS_NUMBER           = 10;
+constexpr size_t RANDOM_FILL_CHUNK_BLOCKS       = 256;
+constexpr size_t RANDOM_FILL_MIN_PARALLEL_BLOCKS = 1 << 15;
+
+// Philox4x32-10ɂv̗B
+// l(, Xg[, v)Ō܂̂ŁA킪Ȃ猋ʂČłA
+// ꊇł͌v͈̔͂𕪂ĕ̃XbhŕɐłB
+// getInstance()̓XbhƂɕʂ̃Xg[蓖ĂB
+class Random {
+protected:
+    uint64_t seed;
+    uint64_t stream;
+    uint64_t counter;
+    uint32_t block[PHILOX_BLOCK_SIZE];
+    size_t   blockPosition;
+    double   spareNormal;
+    bool     hasSpareNormal;
+    
+    static atomic<uint64_t> *getDefaultSeed() {
+        static atomic<uint64_t> DEFAULT_SEED(
+            chrono::system_clock::now().time_since_epoch().count());
+        return &DEFAULT_SEED;
+    }
+    
+    static atomic<uint64_t> *getNextStream() {
+        static atomic<uint64_t> NEXT_STREAM(0);
+        return &NEXT_STREAM;
+    }
+    
+    static double toUniformReal(const uint32_t &upper, const uint32_t &lower) {
+        return (double)(((uint64_t)(upper >> 5) << 26) | (lower >> 6)) / 9007199254740992.0;
+    }
+    
+    uint32_t generate() {
+        if (this->blockPosition == PHILOX_BLOCK_SIZE) {
+            generateBlocks(this->seed, this->stream, this->counter++, 1, this->block);
+            this->blockPosition = 0;
+        }
+        return this->block[this->blockPosition++];
+    }
+    
+    template <typename PutBlocks> 
+    void fillBlocks(const size_t &blocksNumber, PutBlocks putBlocks) {
+        uint64_t firstCounter = this->counter;
+        this->counter += blocksNumber;
+        runInParallel(blocksNumber, RANDOM_FILL_MIN_PARALLEL_BLOCKS, [&](
+            const size_t &begin, 
+            const size_t &end) 
+        {
+            uint32_t blocks[RANDOM_FILL_CHUNK_BLOCKS * PHILOX_BLOCK_SIZE];
+            for (size_t b = begin; b < end; b += RANDOM_FILL_CHUNK_BLOCKS) {
+                size_t number = min(RANDOM_FILL_CHUNK_BLOCKS, end - b);
+                generateBlocks(this->seed, this->stream, firstCounter + b, number, blocks);
+                putBlocks(blocks, b, number);
+            }
+        });
+    }
+public:
+    Random(const uint64_t &seed, const uint64_t &stream) : 
+        seed          (seed), 
+        stream        (stream), 
+        counter       (0), 
+        blockPosition (PHILOX_BLOCK_SIZE), 
+        spareNormal   (0.0), 
+        hasSpareNormal(false) {}
+    
+    // vcounterAblocksNumber̃ubN𐶐B
+    // ̃[v̓ubN̊ԂœƗĂ̂ŃxNgłB
+    static void generateBlocks(
+        const uint64_t &seed, 
+        const uint64_t &stream, 
+        const uint64_t &counter, 
+        const size_t   &blocksNumber, 
+        uint32_t       *blocks) 
+    {
+        for (size_t i = 0; i < blocksNumber; i++) {
+            uint64_t c = counter + i;
+            blocks[i * PHILOX_BLOCK_SIZE + 0] = (uint32_t)c;
+            blocks[i * PHILOX_BLOCK_SIZE + 1] = (uint32_t)(c >> 32);
+            blocks[i * PHILOX_BLOCK_SIZE + 2] = (uint32_t)stream;
+            blocks[i * PHILOX_BLOCK_SIZE + 3] = (uint32_t)(stream >> 32);
+        }
+        uint32_t key0 = (uint32_t)seed;
+        uint32_t key1 = (uint32_t)(seed >> 32);
+        for (size_t r = 0; r < PHILOX_ROUNDS_NUMBER; r++) {
+            for (size_t i = 0; i < blocksNumber; i++) {
+                uint32_t *x = blocks + i * PHILOX_BLOCK_SIZE;
+                uint64_t p0 = (uint64_t)0xD2511F53 * x[0];
+                uint64_t p1 = (uint64_t)0xCD9E8D57 * x[2];
+                uint32_t x0 = (uint32_t)(p1 >> 32) ^ x[1] ^ key0;
+                uint32_t x2 = (uint32_t)(p0 >> 32) ^ x[3] ^ key1;
+                x[1] = (uint32_t)p1;
+                x[3] = (uint32_t)p0;
+                x[0] = x0;
+                x[2] = x2;
+            }
+            key0 += 0x9E3779B9;
+            key1 += 0xBB67AE85;
+        }
+    }
+    
+    double generateUniformReal() {
+        uint32_t upper = generate();
+        return toUniformReal(upper, generate());
+    }
+    
+    template <typename Type> 
+    Type normalDistribution(const Type &a, const Type &b) {
+        if (this->hasSpareNormal) {
+            this->hasSpareNormal = false;
+            return a + b * this->spareNormal;
+        }
+        double radius = sqrt(-2.0 * log(negateRatio(generateUniformReal())));
+        double angle = 2.0 * PI * generateUniformReal();
+        this->spareNormal = radius * sin(angle);
+        this->hasSpareNormal = true;
+        return a + b * radius * cos(angle);
+    }
+    
+    template <typename Type> 
+    Type uniformDistribution(const Type &a, const Type &b) {
+        return a + (Type)(generateUniformReal() * ((double)(b - a) + 1.0));
+    }
+    
+    void fillUniformReals(double *values, const size_t &valuesNumber) {
+        fillBlocks((valuesNumber + 1) / 2, [values, valuesNumber](
+            const uint32_t *blocks, 
+            const size_t   &firstBlockIndex, 
+            const size_t   &blocksNumber) 
+        {
+            for (size_t i = 0; i < blocksNumber; i++) {
+                const uint32_t *x = blocks + i * PHILOX_BLOCK_SIZE;
+                size_t v = (firstBlockIndex + i) * 2;
+                values[v] = toUniformReal(x[0], x[1]);
+                if (v + 1 < valuesNumber) 
+                    values[v + 1] = toUniformReal(x[2], x[3]);
+            }
+        });
+    }
+    
+    void fillNormalDistribution(
+        double       *values, 
+        const size_t &valuesNumber, 
+        const double &mean, 
+        const double &standardDeviation) 
+    {
+        fillBlocks((valuesNumber + 1) / 2, [&](
+            const uint32_t *blocks, 
+            const size_t   &firstBlockIndex, 
+            const size_t   &blocksNumber) 
+        {
+            for (size_t i = 0; i < blocksNumber; i++) {
+                const uint32_t *x = blocks + i * PHILOX_BLOCK_SIZE;
+                size_t v = (firstBlockIndex + i) * 2;
+                double radius = standardDeviation * 
+                    sqrt(-2.0 * log(negateRatio(toUniformReal(x[0], x[1]))));
+                double angle = 2.0 * PI * toUniformReal(x[2], x[3]);
+                values[v] = mean + radius * cos(angle);
+                if (v + 1 < valuesNumber) 
+                    values[v + 1] = mean + radius * sin(angle);
+            }
+        });
+    }
+    
+    // ȍ~ɍXbhƂ̗̎߁A
+    // ĂяoXbh̗Xg[0蒼B
+    static void setSeed(const uint64_t &seed) {
+        getDefaultSeed()->store(seed);
+        getNextStream()->store(1);
+        *getInstance() = Random(seed, 0);
+    }
+    
+    // ĂяoXbh̗A̎̃Xg[stream蒼B
+    static void setStream(const uint64_t &stream) {
+        *getInstance() = Random(getDefaultSeed()->load(), stream);
+    }
+    
+    static Random *getInstance() {
+        static thread_local Random INSTANCE(
+            getDefaultSeed()->load(), 
+            getNextStream()->fetch_add(1));
+        return &INSTANCE;
+    }
+};
+
 #endif
@@ -0,0 +1,113 @@
+#ifndef IMGSTREAM_H
+#define IMGSTREAM_H
+
+#include "help.h"
+#include "mnist.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// x̖摜ɕt郉xBǂ̏o͂ƂvȂB
+constexpr size_t UNKNOWN_LABEL = LABEL_VALUES_NUMBER;
+
+#ifndef _WIN32
+
+// t@CLqq琶̉摜̃R[hǂݍށB
+// R[h̓x1oCg̃xAIMAGE_AREAoCg̉摜B
+// 1̃ob`̃obt@gȂ̂ŁAI̖͂ł͈B
+class RawImageStream {
+protected:
+    int                   fd;
+    bool                  hasLabels;
+    size_t                recordSize;
+    vector<unsigned char> buffer;
+    size_t                bufferedSize;
+    size_t                recordsNumber;
+    bool                  ended;
+    
+    bool isReadable() {
+        pollfd readPoll = {this->fd, POLLIN, 0};
+        return poll(&readPoll, 1, 0) > 0;
+    }
+    
+    void putRecord(const unsigned char *record, Image *image) {
+        size_t label = UNKNOWN_LABEL;
+        if (this->hasLabels) {
+            label = *record++;
+            if (label >= LABEL_VALUES_NUMBER) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "R[h", this->recordsNumber, "̃x", label, "słB");
+        }
+        memcpy(image->getIntensities(), record, IMAGE_AREA);
+        image->setIndex(this->recordsNumber++);
+        image->setLabel(label);
+    }
+public:
+    RawImageStream(
+        const int    &fd, 
+        const bool   &hasLabels, 
+        const size_t &batchSize) : 
+            fd           (fd), 
+            hasLabels    (hasLabels), 
+            recordSize   (IMAGE_AREA + (hasLabels ? 1 : 0)), 
+            buffer       (recordSize * batchSize), 
+            bufferedSize (0), 
+            recordsNumber(0), 
+            ended        (false) {}
+    
+    // images̐܂ŉ摜ǂݍ݁Aǂݍ񂾐ԂB͂I0ԂB
+    // 1łǂݍ񂾌œ͂r؂ꂽAob`܂̂҂ɕԂB
+    size_t read(MNIST *images) {
+        size_t imagesNumber = 0;
+        for (;;) {
+            size_t position = 0;
+            while (imagesNumber < images->size() && 
+                this->bufferedSize - position >= this->recordSize) 
+            {
+                putRecord(&this->buffer[position], (*images)[imagesNumber++].get());
+                position += this->recordSize;
+            }
+            memmove(&this->buffer[0], &this->buffer[position], this->bufferedSize - position);
+            this->bufferedSize -= position;
+            if (imagesNumber == images->size() || 
+                this->ended || 
+                (imagesNumber != 0 && !isReadable())) 
+                break;
+            ssize_t size = ::read(
+                this->fd, 
+                &this->buffer[this->bufferedSize], 
+                this->buffer.size() - this->bufferedSize);
+            if (size <= 0) 
+                this->ended = true;
+            else 
+                this->bufferedSize += size;
+        }
+        if (imagesNumber == 0 && this->bufferedSize != 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "͂r̃R[hŏI܂B");
+        return imagesNumber;
+    }
+};
+
+#else
+
+class RawImageStream {
+public:
+    RawImageStream(
+        const int    &fd, 
+        const bool   &hasLabels, 
+        const size_t &batchSize) {}
+    
+    size_t read(MNIST *images) {
+        throw describe(__FILE__, "(", __LINE__, "): " , "̊łstream߂g܂B");
+    }
+};
+
+#endif
+
+#endif
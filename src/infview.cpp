@@ -1,11 +1,14 @@
 #include "help.h"
+#include "logsink.h"
 #include "mnist.h"
 #include <cmath>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -13,6 +16,44 @@ using namespace std;
 #define DEFAULT_INFER_LABELS_FILE "data/infer.labels"
 #define DEFAULT_ONLY_MISTAKE      "yes"
 
+// ܂Ƃ߂ăeLXgA[gɂ摜̍ő吔B
+constexpr size_t RENDER_CHUNK_SIZE      = 256;
+constexpr size_t RENDER_MIN_PART_SIZE   = 16;
+
+struct InferRecord {
+    size_t inferIndex;
+    size_t imageIndex;
+    size_t label;
+    size_t answer;
+};
+
+// ̋L^̉摜̃eLXgA[g𕡐̃XbhōAL^̏ɏo͂B
+void putInferRecords(MappedMNIST *mnist, vector<InferRecord> *records, vector<string> *texts) {
+    texts->resize(records->size());
+    runInParallel(records->size(), RENDER_MIN_PART_SIZE, [mnist, records, texts](
+        const size_t &begin, 
+        const size_t &end) 
+    {
+        for (size_t i = begin; i < end; i++) {
+            auto r = &(*records)[i];
+            auto text = &(*texts)[i];
+            text->clear();
+            appendTextArt(text, mnist->getIntensities(r->imageIndex));
+            stringstream ss;
+            ss << 
+                "infer="  << r->inferIndex << " "  << 
+                "image="  << r->imageIndex << " "  << 
+                "label="  << r->label      << " "  << 
+                "answer=" << r->answer     << "\n\n";
+            text->append(ss.str());
+        }
+    });
+    for (auto &t : *texts) 
+        cout << t;
+    cout.flush();
+    records->clear();
+}
+
 const string USAGE = 
 "infviewnnet̐胍OeLXgA[g\܂B\n"
 "g: ./infview ݒ...\n"
@@ -49,36 +90,35 @@ int main(int argc, char **argv) {
         if (YES_OR_NO.count((*conf)["onlyMistake"]) == 0) 
             throw describe(__FILE__, "(", __LINE__, "): " , "'onlyMistake'yes܂nołȂ΂Ȃ܂B");
         
-        auto inferMNIST = readMNIST(
-            *openFile<ifstream>((*conf)["inferImagesFile"], ios::in | ios::binary), 
-            *openFile<ifstream>((*conf)["inferLabelsFile"], ios::in | ios::binary));
+        MappedMNIST inferMNIST((*conf)["inferImagesFile"], (*conf)["inferLabelsFile"]);
         
-        string line;
-        while (getLineAndChopCR(cin, line)) {
-            vector<string> tokens;
-            tokenize(line, " \t", true, [&tokens](const string &token) {
-                tokens.push_back(token);
-            });
+        setBinaryMode(stdin);
+        LogReader reader(&cin);
+        vector<string> tokens;
+        vector<InferRecord> records;
+        vector<string> texts;
+        records.reserve(RENDER_CHUNK_SIZE);
+        while (reader.read(&tokens)) {
             if (tokens.size() < 1 || 
                 tokens[0] != "doneInferImage") 
                 continue;
             if (tokens.size() != 5) 
                 throw describe(__FILE__, "(", __LINE__, "): " , "Ǒ`słB");
-            size_t inferIndex = s2ul(tokens[1]);
-            size_t imageIndex = s2ul(tokens[2]);
-            size_t label = s2ul(tokens[3]);
-            size_t answer = s2ul(tokens[4]);
-            if (label != answer || 
+            InferRecord record = {
+                s2ul(tokens[1]), 
+                s2ul(tokens[2]), 
+                s2ul(tokens[3]), 
+                s2ul(tokens[4]), 
+            };
+            if (record.imageIndex >= inferMNIST.getImagesNumber()) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "摜̔ԍ", record.imageIndex, "摜̐𒴂Ă܂B");
+            if (record.label != record.answer || 
                 !YES_OR_NO.at((*conf)["onlyMistake"])) 
-            {
-                (*inferMNIST)[imageIndex]->putTextArt(cout);
-                cout << 
-                    "infer="  << inferIndex << " "  << 
-                    "image="  << imageIndex << " "  << 
-                    "label="  << label      << " "  << 
-                    "answer=" << answer     << endl << endl;
-            }
+                records.push_back(record);
+            if (records.size() == RENDER_CHUNK_SIZE) 
+                putInferRecords(&inferMNIST, &records, &texts);
         }
+        putInferRecords(&inferMNIST, &records, &texts);
     } catch (const string &message) {
         cerr << message << endl;
         result = 1;
@@ -2,58 +2,116 @@
 #define LAYER_H
 
 #include "actfunc.h"
+#include "arena.h"
 #include "help.h"
 #include "mnist.h"
 #include "neuron.h"
 #include "wgtinit.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <vector>
 
 using namespace std;
 
+// _Ɏglbg[N͏d݂ƃoCAXmۂA
+// wƂ̏óÁA덷Az̔zƃj[͍ȂB
+enum NetworkMode {
+    TRAINING_MODE, 
+    INFERENCE_MODE, 
+};
+
 class Layer {
 protected:
-    vector<shared_ptr<Neuron>> neurons;
+    size_t                      neuronsNumber;
+    NetworkMode                 mode;
+    Arena                      *arena;
+    double                     *outputs;
+    vector<shared_ptr<Neuron>>  neurons;
+    vector<unsigned char>       droppedMask;
+    vector<size_t>              dropCandidates;
+    vector<double>              dropRandoms;
+    
+    Layer() : 
+        neuronsNumber(0), 
+        mode         (TRAINING_MODE), 
+        arena        (nullptr), 
+        outputs      (nullptr) {}
+    
+    template <typename NeuronType> 
+    size_t computeNeuronsArenaSize(const NetworkMode &mode) {
+        if (mode == INFERENCE_MODE) 
+            return 0;
+        return 
+            Arena::computeArraySize<double>(this->neuronsNumber) + 
+            Arena::computeObjectsSize<NeuronType>(this->neuronsNumber);
+    }
+    
+    void allocateOutputs(Arena *arena, const NetworkMode &mode) {
+        this->mode = mode;
+        this->arena = arena;
+        if (mode == INFERENCE_MODE) 
+            return;
+        this->outputs = arena->allocateArray<double>(this->neuronsNumber);
+        this->neurons.reserve(this->neuronsNumber);
+        this->droppedMask.assign(this->neuronsNumber, 0);
+    }
 public:
+    size_t getNeuronsNumber() 
+        { return this->neuronsNumber; }
+    double *getOutputs() 
+        { return this->outputs; }
     vector<shared_ptr<Neuron>> *getNeurons()  
         { return &this->neurons; }
+    // j[̔ԍ̏ɁAƂj[Ȃ1B
+    const unsigned char *getDroppedMask() 
+        { return this->droppedMask.data(); }
     virtual double getDropoutRatio() 
         { return 0.0; }
+    virtual bool isFrozen() 
+        { return false; }
     virtual ActivationFunction *getActivationFunction() 
         { throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB"); }
+    virtual size_t computeArenaSize(
+        const size_t      &sourceNeuronsNumber, 
+        const NetworkMode &mode) 
+        { throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB"); }
+    virtual void allocate(Arena *arena, const NetworkMode &mode) 
+        { throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB"); }
     virtual void connect(
         Layer                *sourceLayer, 
         WeightInitialization *weightInitializtion) 
         { throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB"); }
+    virtual void read(istream &is) 
+        { throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB"); }
+    virtual void write(ostream &os) 
+        { throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB"); }
+    virtual void readSparse(istream &is) 
+        { throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB"); }
+    virtual void writeSparse(ostream &os) 
+        { throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB"); }
     
     void dropNeurons() {
-        size_t number = (double)getNeurons()->size() * getDropoutRatio();
-        vector<size_t> neuronsIndices(getNeurons()->size());
-        for (auto i = 0; i < getNeurons()->size(); i++) 
-            neuronsIndices[i] = i;
+        size_t neuronsNumber = this->neuronsNumber;
+        size_t number = (double)neuronsNumber * getDropoutRatio();
+        if (number == 0) 
+            return;
+        this->dropCandidates.resize(neuronsNumber);
+        this->dropRandoms.resize(number);
+        for (auto i = 0; i < neuronsNumber; i++) 
+            this->dropCandidates[i] = i;
+        Random::getInstance()->fillUniformReals(&this->dropRandoms[0], number);
         for (auto i = 0; i < number; i++) {
-            size_t j = Random::getInstance()->uniformDistribution<size_t>(
-                0, getNeurons()->size() - i - 1);
-            (*getNeurons())[neuronsIndices[j]]->drop();
-            neuronsIndices[j] = neuronsIndices[getNeurons()->size() - i - 1];
+            size_t j = (size_t)(this->dropRandoms[i] * (double)(neuronsNumber - i));
+            this->droppedMask[this->dropCandidates[j]] = 1;
+            this->dropCandidates[j] = this->dropCandidates[neuronsNumber - i - 1];
         }
     }
     
     void restoreNeurons() {
-        for (auto n : *getNeurons()) 
-            n->restore();
-    }
-    
-    void read(istream &is) {
-        for (auto n : this->neurons) 
-            n->read(is);
-    }
-    
-    void write(ostream &os) {
-        for (auto n : this->neurons) 
-            n->write(os);
+        fill(this->droppedMask.begin(), this->droppedMask.end(), 0);
     }
 };
 
@@ -72,39 +130,234 @@ public:
     InputLayer(const double &dropoutRatio) : 
         NotOutputLayer(dropoutRatio) 
     {
-        for (auto i = 0; i < IMAGE_AREA; i++) 
-            this->neurons.push_back(newInstance<InputNeuron>());
+        this->neuronsNumber = IMAGE_AREA;
+    }
+    
+    virtual size_t computeArenaSize(
+        const size_t      &sourceNeuronsNumber, 
+        const NetworkMode &mode) override 
+    {
+        return computeNeuronsArenaSize<InputNeuron>(mode);
+    }
+    
+    virtual void allocate(Arena *arena, const NetworkMode &mode) override {
+        allocateOutputs(arena, mode);
+        if (mode == INFERENCE_MODE) 
+            return;
+        for (auto i = 0; i < this->neuronsNumber; i++) 
+            this->neurons.push_back(newArenaInstance<InputNeuron>(
+                arena, 
+                this->outputs + i));
     }
 };
 
 class NotInputLayer : public virtual Layer {
 protected:
     ActivationFunction *activationFunction;
+    double             *biases;
+    double             *biasGradients;
+    double             *inputs;
+    double             *errors;
     
     NotInputLayer(ActivationFunction *activationFunction) : 
-        activationFunction(activationFunction) {}
+        activationFunction(activationFunction), 
+        biases            (nullptr), 
+        biasGradients     (nullptr), 
+        inputs            (nullptr), 
+        errors            (nullptr) {}
+    
+    size_t computeNotInputArenaSize(const NetworkMode &mode) {
+        return (mode == INFERENCE_MODE ? 1 : 4) * Arena::computeArraySize<double>(this->neuronsNumber);
+    }
+    
+    void allocateNotInput() {
+        this->biases = this->arena->allocateArray<double>(this->neuronsNumber);
+        if (this->mode == TRAINING_MODE) {
+            this->biasGradients = this->arena->allocateArray<double>(this->neuronsNumber);
+            this->inputs        = this->arena->allocateArray<double>(this->neuronsNumber);
+            this->errors        = this->arena->allocateArray<double>(this->neuronsNumber);
+        }
+        Random::getInstance()->fillNormalDistribution(
+            this->biases, 
+            this->neuronsNumber, 
+            0.0, 
+            1.0);
+    }
+    
+    template <typename NeuronType> 
+    shared_ptr<Neuron> newNotInputNeuron(const size_t &index) {
+        return newArenaInstance<NeuronType>(
+            this->arena, 
+            this->outputs       + index, 
+            this->biases        + index, 
+            this->inputs        + index, 
+            this->errors        + index, 
+            this->biasGradients + index);
+    }
 public:
     virtual ActivationFunction *getActivationFunction() override 
         { return this->activationFunction; }
+    double *getBiases() 
+        { return this->biases; }
+    double *getBiasGradients() 
+        { return this->biasGradients; }
+    double *getInputs() 
+        { return this->inputs; }
+    double *getErrors() 
+        { return this->errors; }
 };
 
+// d݂͏o͐̃j[Ƃɓ͌̏ɕׂB
+// weights[o͐̔ԍ * ͌̐ + ͌̔ԍ]
 class FullyConnectedLayer : public virtual Layer {
+protected:
+    size_t                sourceNeuronsNumber;
+    double               *weights;
+    double               *weightGradients;
+    vector<unsigned char> prunedMask;
+    
+    FullyConnectedLayer() : 
+        sourceNeuronsNumber(0), 
+        weights            (nullptr), 
+        weightGradients    (nullptr) {}
+    
+    size_t computeConnectionsArenaSize(
+        const size_t      &sourceNeuronsNumber, 
+        const NetworkMode &mode) 
+    {
+        size_t synapsesNumber = sourceNeuronsNumber * this->neuronsNumber;
+        return (mode == INFERENCE_MODE ? 1 : 2) * Arena::computeArraySize<double>(synapsesNumber);
+    }
+    
+    // j[ƂɃoCAXƁA͌̏̏d݂ǂݏB
+    void readParameters(istream &is, double *biases) {
+        for (auto j = 0; j < this->neuronsNumber; j++) {
+            readParameter(is, biases + j);
+            for (auto i = 0; i < this->sourceNeuronsNumber; i++) 
+                readParameter(is, this->weights + j * this->sourceNeuronsNumber + i);
+        }
+    }
+    
+    void writeParameters(ostream &os, const double *biases) {
+        for (auto j = 0; j < this->neuronsNumber; j++) {
+            os.write((const char *)(biases + j), sizeof(double));
+            os.write(
+                (const char *)(this->weights + j * this->sourceNeuronsNumber), 
+                this->sourceNeuronsNumber * sizeof(double));
+        }
+    }
+    
+    // oCAXSďAd݂ksi[(CSR)ŏB
+    // s̎n܂̈ʒu(j[̐ + 1)A0łȂd݂̓͌̔ԍȀd݂̏B
+    void readSparseParameters(istream &is, double *biases) {
+        for (auto j = 0; j < this->neuronsNumber; j++) 
+            readParameter(is, biases + j);
+        vector<uint32_t> rowOffsets(this->neuronsNumber + 1);
+        for (auto &o : rowOffsets) 
+            readParameter(is, &o);
+        // ꂽt@Cő傫ȗ̈mۂA͈͂̊Oǂݏ肵Ȃ悤ɁA
+        // s̎n܂̈ʒuĂAǂ̍s͌̐𒴂ȂƂm߂B
+        if (rowOffsets[0] != 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "aȃp[^Ă܂B");
+        for (auto j = 0; j < this->neuronsNumber; j++) {
+            if (rowOffsets[j + 1] < rowOffsets[j] || 
+                rowOffsets[j + 1] - rowOffsets[j] > this->sourceNeuronsNumber) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "aȃp[^Ă܂B");
+        }
+        vector<uint32_t> columns(rowOffsets.back());
+        for (auto &c : columns) {
+            readParameter(is, &c);
+            if (c >= this->sourceNeuronsNumber) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "aȃp[^Ă܂B");
+        }
+        fill(this->weights, this->weights + this->neuronsNumber * this->sourceNeuronsNumber, 0.0);
+        for (auto j = 0; j < this->neuronsNumber; j++) {
+            for (auto k = rowOffsets[j]; k < rowOffsets[j + 1]; k++) 
+                readParameter(is, this->weights + j * this->sourceNeuronsNumber + columns[k]);
+        }
+    }
+    
+    void writeSparseParameters(ostream &os, const double *biases) {
+        os.write((const char *)biases, this->neuronsNumber * sizeof(double));
+        size_t synapsesNumber = this->neuronsNumber * this->sourceNeuronsNumber;
+        uint32_t offset = 0;
+        os.write((const char *)&offset, sizeof(uint32_t));
+        for (auto j = 0; j < this->neuronsNumber; j++) {
+            auto row = this->weights + j * this->sourceNeuronsNumber;
+            offset += this->sourceNeuronsNumber - count(row, row + this->sourceNeuronsNumber, 0.0);
+            os.write((const char *)&offset, sizeof(uint32_t));
+        }
+        for (uint32_t i = 0; i < synapsesNumber; i++) {
+            if (this->weights[i] == 0.0) 
+                continue;
+            uint32_t column = i % this->sourceNeuronsNumber;
+            os.write((const char *)&column, sizeof(uint32_t));
+        }
+        for (size_t i = 0; i < synapsesNumber; i++) {
+            if (this->weights[i] != 0.0) 
+                os.write((const char *)(this->weights + i), sizeof(double));
+        }
+    }
+    
+    template <typename Type> 
+    static void readParameter(istream &is, Type *parameter) {
+        is.read((char *)parameter, sizeof(Type));
+        if (is.gcount() < sizeof(Type)) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "p[^ǂݍ߂܂B");
+    }
 public:
+    size_t getSourceNeuronsNumber() 
+        { return this->sourceNeuronsNumber; }
+    double *getWeights() 
+        { return this->weights; }
+    double *getWeightGradients() 
+        { return this->weightGradients; }
+    
+    // Βl̏ɏd݂sparsitẙ0ɂA0łȂd݂̐ԂB
+    // 0ɂȂd݂prunedMaskɊoAclearPrunedWeights0ɖ߂悤ɂB
+    size_t pruneWeights(const double &sparsity) {
+        size_t synapsesNumber = this->neuronsNumber * this->sourceNeuronsNumber;
+        size_t prunedNumber = (size_t)(sparsity * (double)synapsesNumber);
+        vector<size_t> indices(synapsesNumber);
+        for (size_t i = 0; i < synapsesNumber; i++) 
+            indices[i] = i;
+        auto weights = this->weights;
+        nth_element(
+            indices.begin(), 
+            indices.begin() + prunedNumber, 
+            indices.end(), 
+            [weights](const size_t &a, const size_t &b) {
+                return fabs(weights[a]) < fabs(weights[b]);
+            });
+        for (size_t i = 0; i < prunedNumber; i++) 
+            this->weights[indices[i]] = 0.0;
+        this->prunedMask.resize(synapsesNumber);
+        for (size_t i = 0; i < synapsesNumber; i++) 
+            this->prunedMask[i] = this->weights[i] == 0.0;
+        return synapsesNumber - count(this->prunedMask.begin(), this->prunedMask.end(), 1);
+    }
+    
+    // pruneWeights0ɂd݂0ɖ߂Bd݂̏1Ȃ߂邾ɂB
+    void clearPrunedWeights() {
+        auto mask = this->prunedMask.data();
+        for (size_t i = 0; i < this->prunedMask.size(); i++) 
+            this->weights[i] = mask[i] ? 0.0 : this->weights[i];
+    }
+    
     virtual void connect(
         Layer                *sourceLayer, 
         WeightInitialization *weightInitializtion) override 
     {
-        for (auto src : *sourceLayer->getNeurons()) {
-            for (auto dest : this->neurons) {
-                auto s = newInstance<Synapse>(
-                    src.get(), 
-                    dest.get(), 
-                    weightInitializtion->generateWeight(
-                        sourceLayer->getNeurons()->size()));
-                src->getOutputSynapses()->push_back(s);
-                dest->getInputSynapses()->push_back(s);
-            }
-        }
+        this->sourceNeuronsNumber = sourceLayer->getNeuronsNumber();
+        size_t synapsesNumber = this->sourceNeuronsNumber * this->neuronsNumber;
+        this->weights = this->arena->allocateArray<double>(synapsesNumber);
+        weightInitializtion->generateWeights(
+            this->sourceNeuronsNumber, 
+            this->weights, 
+            synapsesNumber);
+        if (this->mode == INFERENCE_MODE) 
+            return;
+        this->weightGradients = this->arena->allocateArray<double>(synapsesNumber);
     }
 };
 
@@ -113,22 +366,78 @@ public:
     OutputLayer(ActivationFunction *activationFunction) : 
         NotInputLayer(activationFunction) 
     {
-        for (auto i = 0; i < LABEL_VALUES_NUMBER; i++) 
-            this->neurons.push_back(newInstance<OutputNeuron>());
+        this->neuronsNumber = LABEL_VALUES_NUMBER;
+    }
+    
+    virtual size_t computeArenaSize(
+        const size_t      &sourceNeuronsNumber, 
+        const NetworkMode &mode) override 
+    {
+        return 
+            computeNeuronsArenaSize<OutputNeuron>(mode) + 
+            computeNotInputArenaSize(mode) + 
+            computeConnectionsArenaSize(sourceNeuronsNumber, mode);
+    }
+    
+    virtual void allocate(Arena *arena, const NetworkMode &mode) override {
+        allocateOutputs(arena, mode);
+        allocateNotInput();
+        if (mode == INFERENCE_MODE) 
+            return;
+        for (auto i = 0; i < this->neuronsNumber; i++) 
+            this->neurons.push_back(newNotInputNeuron<OutputNeuron>(i));
+    }
+    
+    virtual void read(istream &is) override {
+        readParameters(is, this->biases);
+    }
+    
+    virtual void write(ostream &os) override {
+        writeParameters(os, this->biases);
+    }
+    
+    virtual void readSparse(istream &is) override {
+        readSparseParameters(is, this->biases);
+    }
+    
+    virtual void writeSparse(ostream &os) override {
+        writeSparseParameters(os, this->biases);
     }
 };
 
 class HiddenLayer : public NotOutputLayer, public NotInputLayer {
 protected:
+    bool frozen;
+    
     HiddenLayer(
         const size_t       &neuronsNumber, 
         const double       &dropoutRatio, 
-        ActivationFunction *activationFunction) : 
+        ActivationFunction *activationFunction, 
+        const bool         &frozen) : 
             NotOutputLayer(dropoutRatio), 
-            NotInputLayer (activationFunction) 
+            NotInputLayer (activationFunction), 
+            frozen        (frozen) 
     {
-        for (auto i = 0; i < neuronsNumber; i++) 
-            this->neurons.push_back(newInstance<HiddenNeuron>());
+        this->neuronsNumber = neuronsNumber;
+    }
+    
+    size_t computeHiddenArenaSize(const NetworkMode &mode) {
+        return 
+            computeNeuronsArenaSize<HiddenNeuron>(mode) + 
+            computeNotInputArenaSize(mode);
+    }
+public:
+    // w͌PŃp[^XVA덷߂ȂB
+    virtual bool isFrozen() override 
+        { return this->frozen; }
+    
+    virtual void allocate(Arena *arena, const NetworkMode &mode) override {
+        allocateOutputs(arena, mode);
+        allocateNotInput();
+        if (mode == INFERENCE_MODE) 
+            return;
+        for (auto i = 0; i < this->neuronsNumber; i++) 
+            this->neurons.push_back(newNotInputNeuron<HiddenNeuron>(i));
     }
 };
 
@@ -137,8 +446,34 @@ public:
     FullyConnectedHiddenLayer(
         const size_t       &neuronsNumber, 
         const double       &dropoutRatio, 
-        ActivationFunction *activationFunction) : 
-        HiddenLayer(neuronsNumber, dropoutRatio, activationFunction) {}
+        ActivationFunction *activationFunction, 
+        const bool         &frozen) : 
+        HiddenLayer(neuronsNumber, dropoutRatio, activationFunction, frozen) {}
+    
+    virtual size_t computeArenaSize(
+        const size_t      &sourceNeuronsNumber, 
+        const NetworkMode &mode) override 
+    {
+        return 
+            computeHiddenArenaSize(mode) + 
+            computeConnectionsArenaSize(sourceNeuronsNumber, mode);
+    }
+    
+    virtual void read(istream &is) override {
+        readParameters(is, this->biases);
+    }
+    
+    virtual void write(ostream &os) override {
+        writeParameters(os, this->biases);
+    }
+    
+    virtual void readSparse(istream &is) override {
+        readSparseParameters(is, this->biases);
+    }
+    
+    virtual void writeSparse(ostream &os) override {
+        writeSparseParameters(os, this->biases);
+    }
 };
 
 #endif
@@ -0,0 +1,320 @@
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include "help.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace std;
+
+enum LogRecordType : unsigned char {
+    DONE_TRAIN_EPOCH, 
+    DONE_TRAIN, 
+    DONE_INFER_IMAGE, 
+    DONE_INFER, 
+    DONE_STREAM_IMAGE, 
+    DONE_SERVE_INTERVAL, 
+    DONE_SERVE, 
+    DONE_COUNT_ALLOCATIONS, 
+    DONE_INFER_SCORES, 
+    DONE_SWEEP_EPOCH, 
+    DONE_SWEEP_TRIAL, 
+    DONE_INFER_MODEL, 
+    DONE_PRUNE, 
+    DONE_COMPRESS_LAYER, 
+    DONE_COMPRESS, 
+    DONE_TUNE_TRAIN, 
+    DONE_TUNE_INFER, 
+    DONE_PERF_PHASE, 
+    LOG_RECORD_TYPES_NUMBER, 
+};
+
+// L^̎ނƂ̖Oƃf[^̕сBu͕Ad͕_B
+// *͌JԂ̐ŁǍ̕т𐔂JԂB
+struct LogRecordFormat {
+    const char *name;
+    const char *fields;
+};
+
+constexpr LogRecordFormat LOG_RECORD_FORMATS[LOG_RECORD_TYPES_NUMBER] = {
+    {"doneTrainEpoch",       "uudud"}, 
+    {"doneTrain",            "udud"}, 
+    {"doneInferImage",       "uuuu"}, 
+    {"doneInfer",            "ud"}, 
+    {"doneStreamImage",      "uu"}, 
+    {"doneServeInterval",    "uddddd"}, 
+    {"doneServe",            "uddddd"}, 
+    {"doneCountAllocations", "u"}, 
+    {"doneInferScores",      "uu*ud"}, 
+    {"doneSweepEpoch",       "uuudud"}, 
+    {"doneSweepTrial",       "uuudu"}, 
+    {"doneInferModel",       "uud"}, 
+    {"donePrune",            "uuu"}, 
+    {"doneCompressLayer",    "uuuud"}, 
+    {"doneCompress",         "udud"}, 
+    {"doneTuneTrain",        "uuud"}, 
+    {"doneTuneInfer",        "uud"}, 
+    {"donePerfPhase",        "uuuuuuu"}, 
+};
+
+constexpr char   BINARY_LOG_MAGIC[]       = "NNETLOG\x01";
+constexpr size_t BINARY_LOG_MAGIC_SIZE    = 8;
+constexpr size_t BINARY_LOG_BUFFER_SIZE   = 1 << 16;
+
+class LogSink {
+protected:
+    virtual void beginRecord(const LogRecordType &type) = 0;
+    virtual void putUnsigned(const uint64_t &value) = 0;
+    virtual void putDouble(const double &value) = 0;
+    virtual void endRecord() = 0;
+    
+    void putFields(const LogRecordType &type, const size_t &index) {
+        if (LOG_RECORD_FORMATS[type].fields[index] != '\0' && 
+            LOG_RECORD_FORMATS[type].fields[index] != '*') 
+            throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB");
+    }
+    
+    template <typename ...Arguments> 
+    void putFields(
+        const LogRecordType &type, 
+        const size_t        &index, 
+        const double        &value, 
+        Arguments&&...       arguments) 
+    {
+        if (LOG_RECORD_FORMATS[type].fields[index] != 'd') 
+            throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB");
+        putDouble(value);
+        putFields(type, index + 1, arguments...);
+    }
+    
+    template <typename ...Arguments> 
+    void putFields(
+        const LogRecordType &type, 
+        const size_t        &index, 
+        const size_t        &value, 
+        Arguments&&...       arguments) 
+    {
+        if (LOG_RECORD_FORMATS[type].fields[index] != 'u') 
+            throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB");
+        putUnsigned(value);
+        putFields(type, index + 1, arguments...);
+    }
+public:
+    virtual ~LogSink() {}
+    virtual void flush() = 0;
+    
+    template <typename ...Arguments> 
+    void put(const LogRecordType &type, Arguments&&... arguments) {
+        beginRecord(type);
+        putFields(type, 0, arguments...);
+        endRecord();
+    }
+    
+    // '*'O̕тargumentsŏA(, _)̑gnumberB
+    template <typename ...Arguments> 
+    void putRepeated(
+        const LogRecordType &type, 
+        const size_t        *unsigneds, 
+        const double        *doubles, 
+        const size_t        &number, 
+        Arguments&&...       arguments) 
+    {
+        if (strchr(LOG_RECORD_FORMATS[type].fields, '*') == nullptr || 
+            strcmp(strchr(LOG_RECORD_FORMATS[type].fields, '*'), "*ud") != 0) 
+            throw describe(__FILE__, "(", __LINE__, "): ", "sȌĂяołB");
+        beginRecord(type);
+        putFields(type, 0, arguments...);
+        putUnsigned(number);
+        for (size_t i = 0; i < number; i++) {
+            putUnsigned(unsigneds[i]);
+            putDouble(doubles[i]);
+        }
+        endRecord();
+    }
+};
+
+// ^u؂̍sBsƂɂ̓tbVAflush()܂ŗ߂B
+class TextLogSink : public LogSink {
+protected:
+    ostream *os;
+    
+    virtual void beginRecord(const LogRecordType &type) override {
+        *this->os << LOG_RECORD_FORMATS[type].name;
+    }
+    
+    virtual void putUnsigned(const uint64_t &value) override {
+        *this->os << '\t' << value;
+    }
+    
+    virtual void putDouble(const double &value) override {
+        *this->os << '\t' << value;
+    }
+    
+    virtual void endRecord() override {
+        *this->os << '\n';
+    }
+public:
+    TextLogSink(ostream *os) : os(os) {}
+    
+    virtual void flush() override {
+        this->os->flush();
+    }
+};
+
+// 擪BINARY_LOG_MAGICAL^Ƃ1oCg̎ނƃf[^B
+// 7rbg̉ϒA_doublẽoCgB
+class BinaryLogSink : public LogSink {
+protected:
+    ostream      *os;
+    vector<char>  buffer;
+    
+    virtual void beginRecord(const LogRecordType &type) override {
+        this->buffer.push_back((char)type);
+    }
+    
+    virtual void putUnsigned(const uint64_t &value) override {
+        uint64_t v = value;
+        for (; v >= 0x80; v >>= 7) 
+            this->buffer.push_back((char)((v & 0x7f) | 0x80));
+        this->buffer.push_back((char)v);
+    }
+    
+    virtual void putDouble(const double &value) override {
+        char bytes[sizeof(double)];
+        memcpy(bytes, &value, sizeof(double));
+        this->buffer.insert(this->buffer.end(), bytes, bytes + sizeof(double));
+    }
+    
+    virtual void endRecord() override {
+        if (this->buffer.size() >= BINARY_LOG_BUFFER_SIZE) {
+            this->os->write(&this->buffer[0], this->buffer.size());
+            this->buffer.clear();
+        }
+    }
+public:
+    BinaryLogSink(ostream *os) : os(os) {
+        this->buffer.reserve(BINARY_LOG_BUFFER_SIZE + 64);
+        this->buffer.insert(this->buffer.end(), BINARY_LOG_MAGIC, BINARY_LOG_MAGIC + BINARY_LOG_MAGIC_SIZE);
+    }
+    
+    virtual ~BinaryLogSink() override {
+        flush();
+    }
+    
+    virtual void flush() override {
+        if (!this->buffer.empty()) 
+            this->os->write(&this->buffer[0], this->buffer.size());
+        this->buffer.clear();
+        this->os->flush();
+    }
+};
+
+// Windowsł̓oCĩOs̕ϊŉȂ悤ɕWo͂oCi[hɂB
+inline void setBinaryMode(FILE *file) {
+#ifdef _WIN32
+    _setmode(_fileno(file), _O_BINARY);
+#endif
+}
+
+using MakeLogSinkProc = function<shared_ptr<LogSink>(ostream *)>;
+inline const map<string, MakeLogSinkProc> *getLogFormats() {
+    static const map<string, MakeLogSinkProc> LOG_FORMATS = {
+        {"text",   [](ostream *os) { return newInstance<TextLogSink>(os); }}, 
+        {"binary", [](ostream *os) { return newInstance<BinaryLogSink>(os); }}, 
+    };
+    return &LOG_FORMATS;
+}
+
+// eLXgƃoCîǂ̃Oǂ݁AL^𕶎̕тɂB
+// ŏ̗vf͋L^̎ނ̖OB
+class LogReader {
+protected:
+    istream *is;
+    bool     binary;
+    
+    uint64_t readUnsigned() {
+        uint64_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            int c = this->is->get();
+            if (c == EOF) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "Ǒ`słB");
+            value |= (uint64_t)(c & 0x7f) << shift;
+            if (!(c & 0x80)) 
+                break;
+        }
+        return value;
+    }
+    
+    double readDouble() {
+        double value;
+        this->is->read((char *)&value, sizeof(double));
+        if (this->is->gcount() < sizeof(double)) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "Ǒ`słB");
+        return value;
+    }
+    
+    void readFields(const char *fields, vector<string> *tokens) {
+        for (auto f = fields; *f; f++) {
+            stringstream ss;
+            if (*f == '*') {
+                uint64_t number = readUnsigned();
+                tokens->push_back(to_string(number));
+                for (uint64_t i = 0; i < number; i++) 
+                    readFields(f + 1, tokens);
+                break;
+            }
+            if (*f == 'u') 
+                ss << readUnsigned();
+            else 
+                ss << readDouble();
+            tokens->push_back(ss.str());
+        }
+    }
+public:
+    LogReader(istream *is) : is(is), binary(false) {
+        if (this->is->peek() != BINARY_LOG_MAGIC[0]) 
+            return;
+        char magic[BINARY_LOG_MAGIC_SIZE];
+        this->is->read(magic, BINARY_LOG_MAGIC_SIZE);
+        if (this->is->gcount() < BINARY_LOG_MAGIC_SIZE || 
+            memcmp(magic, BINARY_LOG_MAGIC, BINARY_LOG_MAGIC_SIZE) != 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "Ǒ`słB");
+        this->binary = true;
+    }
+    
+    bool read(vector<string> *tokens) {
+        tokens->clear();
+        if (!this->binary) {
+            string line;
+            if (!getLineAndChopCR(*this->is, line)) 
+                return false;
+            tokenize(line, " \t", true, [tokens](const string &token) {
+                tokens->push_back(token);
+            });
+            return true;
+        }
+        int type = this->is->get();
+        if (type == EOF) 
+            return false;
+        if (type >= LOG_RECORD_TYPES_NUMBER) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "Ǒ`słB");
+        tokens->push_back(LOG_RECORD_FORMATS[type].name);
+        readFields(LOG_RECORD_FORMATS[type].fields, tokens);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,221 @@
+#ifndef LOWRANK_H
+#define LOWRANK_H
+
+#include "help.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// БRr@ŁȂg̓ς̊ȉɂȂ璼Ƃ݂ȂB
+constexpr double LOW_RANK_ORTHOGONALITY_TOLERANCE = 1e-12;
+
+// БRr@̑|̍ő̐B
+constexpr size_t LOW_RANK_MAX_SWEEPS_NUMBER = 60;
+
+// Sڑw̏d݂̍sW(j[̐ x ͌̐)ْ̓lW = U S V^TB
+// Z̗̎̑g]ĒБRr@ŋ߁Aْl̑傫ɕׂB
+// Krank̋ߎ́A͌rank̓كxNgɎʂwƁAo͐ɖ߂w̐ςɂłB
+class LowRankFactorization {
+protected:
+    size_t         neuronsNumber;
+    size_t         sourceNeuronsNumber;
+    vector<double> singularValues;
+    vector<double> leftVectors;
+    vector<double> rightVectors;
+    
+    // columns̗(rowsNumber)𒼌A]vectors̗(columnsNumber)ɂ|B
+    static void orthogonalize(
+        double       *columns, 
+        double       *vectors, 
+        const size_t &rowsNumber, 
+        const size_t &columnsNumber) 
+    {
+        for (size_t sweep = 0; sweep < LOW_RANK_MAX_SWEEPS_NUMBER; sweep++) {
+            bool rotated = false;
+            for (size_t p = 0; p + 1 < columnsNumber; p++) {
+                for (size_t q = p + 1; q < columnsNumber; q++) {
+                    double *a = columns + p * rowsNumber;
+                    double *b = columns + q * rowsNumber;
+                    double alpha = 0.0;
+                    double beta  = 0.0;
+                    double gamma = 0.0;
+                    for (size_t i = 0; i < rowsNumber; i++) {
+                        alpha += a[i] * a[i];
+                        beta  += b[i] * b[i];
+                        gamma += a[i] * b[i];
+                    }
+                    if (fabs(gamma) <= LOW_RANK_ORTHOGONALITY_TOLERANCE * sqrt(alpha * beta)) 
+                        continue;
+                    rotated = true;
+                    double zeta = (beta - alpha) / (2.0 * gamma);
+                    double t = (zeta >= 0.0 ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1.0 + zeta * zeta));
+                    double c = 1.0 / sqrt(1.0 + t * t);
+                    double s = c * t;
+                    rotate(a, b, rowsNumber, c, s);
+                    rotate(vectors + p * columnsNumber, vectors + q * columnsNumber, columnsNumber, c, s);
+                }
+            }
+            if (!rotated) 
+                break;
+        }
+    }
+    
+    static void rotate(
+        double       *a, 
+        double       *b, 
+        const size_t &number, 
+        const double &c, 
+        const double &s) 
+    {
+        for (size_t i = 0; i < number; i++) {
+            double x = a[i];
+            double y = b[i];
+            a[i] = c * x - s * y;
+            b[i] = s * x + c * y;
+        }
+    }
+public:
+    // weights[o͐̔ԍ * ͌̐ + ͌̔ԍ]
+    LowRankFactorization(
+        const double *weights, 
+        const size_t &neuronsNumber, 
+        const size_t &sourceNeuronsNumber) : 
+            neuronsNumber      (neuronsNumber), 
+            sourceNeuronsNumber(sourceNeuronsNumber) 
+    {
+        // ͌̕ȂW̗AłȂW^T̗(W̍s)𒼌B
+        bool transposed = neuronsNumber < sourceNeuronsNumber;
+        size_t rowsNumber    = transposed ? sourceNeuronsNumber : neuronsNumber;
+        size_t columnsNumber = transposed ? neuronsNumber : sourceNeuronsNumber;
+        vector<double> columns(rowsNumber * columnsNumber);
+        for (size_t j = 0; j < neuronsNumber; j++) {
+            for (size_t i = 0; i < sourceNeuronsNumber; i++) {
+                double w = weights[j * sourceNeuronsNumber + i];
+                if (transposed) 
+                    columns[j * rowsNumber + i] = w;
+                else 
+                    columns[i * rowsNumber + j] = w;
+            }
+        }
+        vector<double> vectors(columnsNumber * columnsNumber, 0.0);
+        for (size_t k = 0; k < columnsNumber; k++) 
+            vectors[k * columnsNumber + k] = 1.0;
+        orthogonalize(columns.data(), vectors.data(), rowsNumber, columnsNumber);
+        
+        // ْ̒lAْlŊ̂Ɖ]كxNgB
+        vector<double> norms(columnsNumber);
+        vector<size_t> order(columnsNumber);
+        for (size_t k = 0; k < columnsNumber; k++) {
+            double sum = 0.0;
+            for (size_t i = 0; i < rowsNumber; i++) 
+                sum += columns[k * rowsNumber + i] * columns[k * rowsNumber + i];
+            norms[k] = sqrt(sum);
+            order[k] = k;
+        }
+        stable_sort(order.begin(), order.end(), [&norms](const size_t &a, const size_t &b) {
+            return norms[a] > norms[b];
+        });
+        this->leftVectors.resize(columnsNumber * neuronsNumber);
+        this->rightVectors.resize(columnsNumber * sourceNeuronsNumber);
+        for (size_t r = 0; r < columnsNumber; r++) {
+            size_t k = order[r];
+            this->singularValues.push_back(norms[k]);
+            double *left  = &this->leftVectors[r * neuronsNumber];
+            double *right = &this->rightVectors[r * sourceNeuronsNumber];
+            double *normalized = transposed ? right : left;
+            double *rotation   = transposed ? left : right;
+            for (size_t i = 0; i < rowsNumber; i++) 
+                normalized[i] = norms[k] == 0.0 ? 0.0 : columns[k * rowsNumber + i] / norms[k];
+            copy(
+                vectors.begin() + k * columnsNumber, 
+                vectors.begin() + (k + 1) * columnsNumber, 
+                rotation);
+        }
+    }
+    
+    size_t getMaxRank() 
+        { return this->singularValues.size(); }
+    const vector<double> &getSingularValues() 
+        { return this->singularValues; }
+    
+    // Krank̋ߎɎcAْl2̘åB
+    double computeEnergy(const size_t &rank) {
+        double total = 0.0;
+        double kept = 0.0;
+        for (size_t r = 0; r < this->singularValues.size(); r++) {
+            double energy = this->singularValues[r] * this->singularValues[r];
+            total += energy;
+            if (r < rank) 
+                kept += energy;
+        }
+        return total == 0.0 ? 1.0 : kept / total;
+    }
+    
+    // ْl2̘aenergẙȏcŏ̊KB1ȏB
+    size_t computeRank(const double &energy) {
+        size_t rank = 1;
+        while (rank < getMaxRank() && computeEnergy(rank) < energy) 
+            rank++;
+        return rank;
+    }
+    
+    // Krank̋ߎ2̑w̏d݂ɕBْl̕𗼕Ɋ|B
+    // firstWeights͓͌rank̃j[ւ̏d(rank x ͌̐)A
+    // secondWeightsrank̃j[o͐ւ̏d(j[̐ x rank)B
+    void computeFactors(
+        const size_t &rank, 
+        double       *firstWeights, 
+        double       *secondWeights) 
+    {
+        for (size_t r = 0; r < rank; r++) {
+            double scale = sqrt(this->singularValues[r]);
+            for (size_t i = 0; i < this->sourceNeuronsNumber; i++) 
+                firstWeights[r * this->sourceNeuronsNumber + i] = 
+                    scale * this->rightVectors[r * this->sourceNeuronsNumber + i];
+            for (size_t j = 0; j < this->neuronsNumber; j++) 
+                secondWeights[j * rank + r] = 
+                    scale * this->leftVectors[r * this->neuronsNumber + j];
+        }
+    }
+    
+    size_t getWeightsNumber() 
+        { return this->neuronsNumber * this->sourceNeuronsNumber; }
+    
+    // Krank̋ߎ2̑wɕƂ̏d݂̐B̐Ϙa̐ƓB
+    size_t computeWeightsNumber(const size_t &rank) 
+        { return rank * (this->neuronsNumber + this->sourceNeuronsNumber); }
+};
+
+// ranksɂw̔ԍ(͑w0Ƃ)̍s̑OɁÅK̃j[̐`̑SڑwށB
+// w𐔂̂NetworkBuilderƓA󔒍s'#'Ŏn܂ssB
+inline string insertLowRankLayers(
+    const string              &network, 
+    const map<size_t, size_t> &ranks) 
+{
+    stringstream is(network);
+    string result;
+    string line;
+    size_t layerIndex = 0;
+    while (getLineAndChopCR(is, line)) {
+        vector<string> tokens;
+        tokenize(line, " \t", true, [&tokens](const string &token) {
+            tokens.push_back(token);
+        });
+        if (!tokens.empty() && 
+            tokens[0].at(0) != '#') 
+        {
+            if (ranks.count(layerIndex) != 0) 
+                result += "fullyConnected neuronsNumber=" + to_string(ranks.at(layerIndex)) + " activationFunction=linear\n";
+            layerIndex++;
+        }
+        result += line + "\n";
+    }
+    return result;
+}
+
+#endif
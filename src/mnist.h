@@ -2,10 +2,21 @@
 #define MNIST_H
 
 #include "help.h"
+#include "pages.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <string>
 #include <vector>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 struct LetterIntensity {
@@ -118,19 +129,95 @@ constexpr LetterIntensity PRINTABLE_LETTER_INTENSITIES[PRINTABLE_LETTERS_NUMBER]
     { 72.857143,   0.000000}, 
 };
 
+constexpr size_t INTENSITY_VALUES_NUMBER = 256;
+constexpr size_t TEXT_ART_SIZE           = 
+    (IMAGE_SIDE_LENGTH + 3) * (IMAGE_SIDE_LENGTH / 2 + 2);
+
+// (̋Px, ̋Px)APx̍ł\B
+inline array<char, INTENSITY_VALUES_NUMBER * INTENSITY_VALUES_NUMBER> buildTextArtLetters() {
+    array<char, INTENSITY_VALUES_NUMBER * INTENSITY_VALUES_NUMBER> letters;
+    for (size_t upper = 0; upper < INTENSITY_VALUES_NUMBER; upper++) {
+        for (size_t lower = 0; lower < INTENSITY_VALUES_NUMBER; lower++) {
+            size_t minDiffLetterIndex = 0;
+            double minDiff = 512.0;
+            for (auto i = 0; i < PRINTABLE_LETTERS_NUMBER; i++) {
+                if (i == '\\' - FIRST_PRINTABLE_LETTER) 
+                    continue;
+                double diff = 
+                    fabs((double)upper - 
+                        PRINTABLE_LETTER_INTENSITIES[i].upperIntensity) + 
+                    fabs((double)lower - 
+                        PRINTABLE_LETTER_INTENSITIES[i].lowerIntensity);
+                if (diff < minDiff) {
+                    minDiffLetterIndex = i;
+                    minDiff = diff;
+                }
+            }
+            letters[INTENSITY_VALUES_NUMBER * upper + lower] = 
+                (char)(FIRST_PRINTABLE_LETTER + minDiffLetterIndex);
+        }
+    }
+    return letters;
+}
+
+// ŏɎgƂɈx\B
+inline const char *getTextArtLetters() {
+    static const auto TEXT_ART_LETTERS = buildTextArtLetters();
+    return TEXT_ART_LETTERS.data();
+}
+
+// 摜̃eLXgA[gtexťɒǉB1ŏ㉺2f\B
+inline void appendTextArt(string *text, const unsigned char *intensities) {
+    auto letters = getTextArtLetters();
+    auto appendHorizontalBorder = [text]() {
+        text->push_back('+');
+        text->append(IMAGE_SIDE_LENGTH, '-');
+        text->append("+\n");
+    };
+    
+    appendHorizontalBorder();
+    for (auto y = 0; y < IMAGE_SIDE_LENGTH; y += 2) {
+        auto upper = intensities + IMAGE_SIDE_LENGTH * y;
+        auto lower = upper + IMAGE_SIDE_LENGTH;
+        text->push_back('|');
+        for (auto x = 0; x < IMAGE_SIDE_LENGTH; x++) 
+            text->push_back(letters[INTENSITY_VALUES_NUMBER * upper[x] + lower[x]]);
+        text->append("|\n");
+    }
+    appendHorizontalBorder();
+}
+
+// f̋Px͎ŎAf[^Zbgł܂Ƃ߂Ċmۂ̈wB
 class Image {
 protected:
-    size_t                index;
-    vector<unsigned char> intensities;
-    size_t                label;
+    size_t                 index;
+    vector<unsigned char>  ownIntensities;
+    shared_ptr<PageMemory> storage;
+    unsigned char         *intensities;
+    size_t                 label;
 public:
     Image(const size_t &index) : 
-        index(index), 
-        intensities(IMAGE_SIDE_LENGTH * IMAGE_SIDE_LENGTH) {}
+        index         (index), 
+        ownIntensities(IMAGE_AREA), 
+        intensities   (&ownIntensities[0]) {}
+    // intensitiesstorage̒IMAGE_AREA̋PxwB
+    Image(
+        const size_t                 &index, 
+        const shared_ptr<PageMemory> &storage, 
+        unsigned char                *intensities) : 
+            index      (index), 
+            storage    (storage), 
+            intensities(intensities) {}
+    
+    Image(const Image &) = delete;
+    Image &operator=(const Image &) = delete;
+    
     size_t getIndex() 
         { return this->index; }
-    vector<unsigned char> *getIntensities() 
-        { return &this->intensities; }
+    void setIndex(const size_t &index) 
+        { this->index = index; }
+    unsigned char *getIntensities() 
+        { return this->intensities; }
     unsigned char getIntensity(const size_t &x, const size_t &y) 
         { return this->intensities[IMAGE_SIDE_LENGTH * y + x]; }
     size_t getLabel() 
@@ -139,37 +226,10 @@ public:
         { this->label = label; }
     
     void putTextArt(ostream &os) {
-        auto putHorizontalBorder = [&os]() {
-            os << '+';
-            for (auto x = 0; x < IMAGE_SIDE_LENGTH; x++) 
-                os << '-';
-            os << '+' << endl;
-        };
-        
-        putHorizontalBorder();
-        for (auto y = 0; y < IMAGE_SIDE_LENGTH; y += 2) {
-            os << '|';
-            for (auto x = 0; x < IMAGE_SIDE_LENGTH; x++) {
-                size_t minDiffLetterIndex = 0;
-                double minDiff = 512.0;
-                for (auto i = 0; i < PRINTABLE_LETTERS_NUMBER; i++) {
-                    if (i == '\\' - FIRST_PRINTABLE_LETTER) 
-                        continue;
-                    double diff = 
-                        fabs(getIntensity(x, y)     - 
-                            PRINTABLE_LETTER_INTENSITIES[i].upperIntensity) + 
-                        fabs(getIntensity(x, y + 1) - 
-                            PRINTABLE_LETTER_INTENSITIES[i].lowerIntensity);
-                    if (diff < minDiff) {
-                        minDiffLetterIndex = i;
-                        minDiff = diff;
-                    }
-                }
-                os << (char)(FIRST_PRINTABLE_LETTER + minDiffLetterIndex);
-            }
-            os << '|' << endl;
-        }
-        putHorizontalBorder();
+        string text;
+        text.reserve(TEXT_ART_SIZE);
+        appendTextArt(&text, this->intensities);
+        os << text;
     }
 };
 
@@ -179,24 +239,26 @@ inline shared_ptr<MNIST> readMNIST(istream &imagesIS, istream &labelsIS) {
     auto mnist = newInstance<MNIST>();
     
     imagesIS.seekg(4, ios_base::cur);
-    unsigned long imagesNumber;
-    imagesIS.read((char *)&imagesNumber, sizeof(unsigned long));
+    uint32_t imagesNumber;
+    imagesIS.read((char *)&imagesNumber, sizeof(uint32_t));
     imagesNumber = reverseByteOrder(imagesNumber);
-    unsigned long rowsNumber;
-    imagesIS.read((char *)&rowsNumber, sizeof(unsigned long));
+    uint32_t rowsNumber;
+    imagesIS.read((char *)&rowsNumber, sizeof(uint32_t));
     rowsNumber = reverseByteOrder(rowsNumber);
     if (rowsNumber != IMAGE_SIDE_LENGTH) 
         throw describe(__FILE__, "(", __LINE__, "): ", "摜̍", IMAGE_SIDE_LENGTH, "łȂ΂Ȃ܂B");
-    unsigned long columnsNumber;
-    imagesIS.read((char *)&columnsNumber, sizeof(unsigned long));
+    uint32_t columnsNumber;
+    imagesIS.read((char *)&columnsNumber, sizeof(uint32_t));
     columnsNumber = reverseByteOrder(columnsNumber);
     if (columnsNumber != IMAGE_SIDE_LENGTH) 
         throw describe(__FILE__, "(", __LINE__, "): ", "摜̕", IMAGE_SIDE_LENGTH, "łȂ΂Ȃ܂B");
+    // SẲ摜̋Px1̗̈ɑĒuAVbtɓǂłTLBg؂Ȃ悤ɂB
+    auto storage = newInstance<PageMemory>(IMAGE_AREA * imagesNumber);
+    auto intensities = (unsigned char *)storage->getData();
+    imagesIS.read((char *)intensities, IMAGE_AREA * imagesNumber);
     mnist->resize(imagesNumber);
     for (auto i = 0; i < imagesNumber; i++) 
-        (*mnist)[i] = newInstance<Image>(i);
-    for (auto i = 0; i < imagesNumber; i++) 
-        imagesIS.read((char *)&(*(*mnist)[i]->getIntensities())[0], IMAGE_AREA);
+        (*mnist)[i] = newInstance<Image>(i, storage, intensities + IMAGE_AREA * i);
     
     labelsIS.seekg(8, ios_base::cur);
     for (auto i = 0; i < imagesNumber; i++) {
@@ -208,4 +270,100 @@ inline shared_ptr<MNIST> readMNIST(istream &imagesIS, istream &labelsIS) {
     return mnist;
 }
 
+constexpr size_t MNIST_IMAGES_HEADER_SIZE = 16;
+constexpr size_t MNIST_LABELS_HEADER_SIZE = 8;
+
+// t@C̓eǂݎpŃɎʑB
+// ʑłȂł͑ŜǂݍށB
+class MappedFile {
+protected:
+    const unsigned char   *data;
+    size_t                 size;
+    vector<unsigned char>  buffer;
+public:
+    MappedFile(const string &fileName) : 
+        data(nullptr), 
+        size(0) 
+    {
+#ifndef _WIN32
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'", fileName, "'J܂B");
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0) {
+            close(fd);
+            throw describe(__FILE__, "(", __LINE__, "): " , "'", fileName, "'̑傫𒲂ׂ܂B");
+        }
+        this->size = fileStat.st_size;
+        if (this->size != 0) {
+            void *p = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw describe(__FILE__, "(", __LINE__, "): " , "'", fileName, "'ʑł܂B");
+            }
+            this->data = (const unsigned char *)p;
+        }
+        close(fd);
+#else
+        auto is = openFile<ifstream>(fileName, ios::in | ios::binary);
+        this->buffer.assign(istreambuf_iterator<char>(*is), istreambuf_iterator<char>());
+        this->data = this->buffer.empty() ? nullptr : &this->buffer[0];
+        this->size = this->buffer.size();
+#endif
+    }
+    
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    
+    ~MappedFile() {
+#ifndef _WIN32
+        if (this->data) 
+            munmap((void *)this->data, this->size);
+#endif
+    }
+    
+    const unsigned char *getData() 
+        { return this->data; }
+    size_t getSize() 
+        { return this->size; }
+};
+
+// 摜ƃx̃t@CʑāAImageɓǂݍ܂ɉ摜ƃxQƂB
+class MappedMNIST {
+protected:
+    MappedFile imagesFile;
+    MappedFile labelsFile;
+    size_t     imagesNumber;
+    
+    static uint32_t readHeaderField(MappedFile *file, const size_t &offset) {
+        uint32_t field;
+        memcpy(&field, file->getData() + offset, sizeof(uint32_t));
+        return reverseByteOrder(field);
+    }
+public:
+    MappedMNIST(const string &imagesFileName, const string &labelsFileName) : 
+        imagesFile(imagesFileName), 
+        labelsFile(labelsFileName) 
+    {
+        if (this->imagesFile.getSize() < MNIST_IMAGES_HEADER_SIZE || 
+            this->labelsFile.getSize() < MNIST_LABELS_HEADER_SIZE) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "MNIST̃t@CZ܂B");
+        this->imagesNumber = readHeaderField(&this->imagesFile, 4);
+        if (readHeaderField(&this->imagesFile, 8) != IMAGE_SIDE_LENGTH) 
+            throw describe(__FILE__, "(", __LINE__, "): ", "摜̍", IMAGE_SIDE_LENGTH, "łȂ΂Ȃ܂B");
+        if (readHeaderField(&this->imagesFile, 12) != IMAGE_SIDE_LENGTH) 
+            throw describe(__FILE__, "(", __LINE__, "): ", "摜̕", IMAGE_SIDE_LENGTH, "łȂ΂Ȃ܂B");
+        if (this->imagesFile.getSize() < MNIST_IMAGES_HEADER_SIZE + IMAGE_AREA * this->imagesNumber || 
+            this->labelsFile.getSize() < MNIST_LABELS_HEADER_SIZE + this->imagesNumber) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "MNIST̃t@CZ܂B");
+    }
+    
+    size_t getImagesNumber() 
+        { return this->imagesNumber; }
+    const unsigned char *getIntensities(const size_t &index) 
+        { return this->imagesFile.getData() + MNIST_IMAGES_HEADER_SIZE + IMAGE_AREA * index; }
+    size_t getLabel(const size_t &index) 
+        { return this->labelsFile.getData()[MNIST_LABELS_HEADER_SIZE + index]; }
+};
+
 #endif
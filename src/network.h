@@ -2,13 +2,22 @@
 #define NETWORK_H
 
 #include "actfunc.h"
+#include "allreduce.h"
+#include "arena.h"
 #include "costfunc.h"
+#include "epilogue.h"
 #include "help.h"
 #include "layer.h"
+#include "lowrank.h"
 #include "mnist.h"
 #include "neuron.h"
+#include "perf.h"
+#include "plan.h"
 #include "regriz.h"
+#include "trace.h"
 #include "wgtinit.h"
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -24,15 +33,21 @@ using namespace std;
 #define DEFAULT_FULLY_CONNECTED_NEURONS_NUMBER      "30"
 #define DEFAULT_FULLY_CONNECTED_DROPOUT_RATIO       "0.0"
 #define DEFAULT_FULLY_CONNECTED_ACTIVATION_FUNCTION "sigmoid"
+#define DEFAULT_FULLY_CONNECTED_FROZEN              "no"
 
 #define DEFAULT_OUTPUT_ACTIVATION_FUNCTION "sigmoid"
 
+// aȃp[^̃t@C̐擪̎ʎqBΖȃp[^ƂēǂށB
+constexpr char   SPARSE_PARAMETERS_MAGIC[]    = "NNETCSR\x01";
+constexpr size_t SPARSE_PARAMETERS_MAGIC_SIZE = 8;
+
 struct HyperParameters {
     WeightInitialization *weightInitialization;
     CostFunction         *costFunction;
     Regularization       *regularization;
     double                weightDecayRate;
     double                learningRate;
+    bool                  fastMath;
 };
 
 struct Log {
@@ -55,193 +70,772 @@ struct Log {
     function<void(
         size_t correctAnswersNumber, 
         double costsSum)> doneInfer;
+    function<void(
+        size_t        inferImageIndex, 
+        size_t        imageIndex, 
+        const size_t *labels, 
+        const double *scores, 
+        size_t        scoresNumber)> doneInferScores;
+    function<void(
+        size_t modelIndex, 
+        size_t correctAnswersNumber, 
+        double cost)> doneInferModel;
+    function<void(
+        size_t layerIndex, 
+        size_t weightsNumber, 
+        size_t nonzeroWeightsNumber)> donePrune;
+    function<void(
+        size_t layerIndex, 
+        size_t weightsNumber, 
+        size_t compressedWeightsNumber, 
+        size_t rank, 
+        double energy)> doneCompressLayer;
+    function<void(
+        size_t correctAnswersNumber, 
+        double cost, 
+        size_t compressedCorrectAnswersNumber, 
+        double compressedCost)> doneCompress;
+    function<void(
+        size_t          epochIndex, 
+        size_t          phase, 
+        const uint64_t *counts)> donePerfPhase;
+    function<void(
+        size_t batchSize, 
+        size_t threadsNumber, 
+        bool   fastMath, 
+        double imagesPerSecond)> doneTuneTrain;
+    function<void(
+        size_t threadsNumber, 
+        bool   fastMath, 
+        double imagesPerSecond)> doneTuneInfer;
+    function<void()> doneInferBatch;
+    function<void(
+        size_t allocationsNumber)> doneCountAllocations;
+    function<void(
+        size_t requestsNumber, 
+        double throughput, 
+        double latency50, 
+        double latency90, 
+        double latency99, 
+        double batchSizeAverage)> doneServeInterval;
+    function<void(
+        size_t requestsNumber, 
+        double throughput, 
+        double latency50, 
+        double latency90, 
+        double latency99, 
+        double batchSizeAverage)> doneServe;
     
     Log() : 
         doneTrainEpoch([](size_t, size_t, double, size_t, double) {}), 
         doneTrain([](size_t, double, size_t, double) {}), 
         doneInferImage([](size_t, size_t, size_t, size_t) {}), 
-        doneInfer([](size_t, double) {}) {}
+        doneInfer([](size_t, double) {}), 
+        doneInferScores([](size_t, size_t, const size_t *, const double *, size_t) {}), 
+        doneInferModel([](size_t, size_t, double) {}), 
+        donePrune([](size_t, size_t, size_t) {}), 
+        doneCompressLayer([](size_t, size_t, size_t, size_t, double) {}), 
+        doneCompress([](size_t, double, size_t, double) {}), 
+        donePerfPhase([](size_t, size_t, const uint64_t *) {}), 
+        doneTuneTrain([](size_t, size_t, bool, double) {}), 
+        doneTuneInfer([](size_t, bool, double) {}), 
+        doneInferBatch([]() {}), 
+        doneCountAllocations([](size_t) {}), 
+        doneServeInterval([](size_t, double, double, double, double, double) {}), 
+        doneServe([](size_t, double, double, double, double, double) {}) {}
 };
 
+struct EvalResult {
+    size_t correctAnswersNumber;
+    double costsSum;
+    size_t imagesNumber;
+};
+
+// o͑w̏o͂̂܂܁A܂͑傫scoresNumberdoneInferScoresɓnB
+inline void putInferScores(
+    Log          *log, 
+    const size_t &inferImageIndex, 
+    const size_t &imageIndex, 
+    const double *outputs, 
+    const size_t &scoresNumber, 
+    const bool   &sorts) 
+{
+    size_t labels[LABEL_VALUES_NUMBER];
+    double scores[LABEL_VALUES_NUMBER];
+    for (size_t i = 0; i < LABEL_VALUES_NUMBER; i++) 
+        labels[i] = i;
+    if (sorts) {
+        partial_sort(
+            labels, 
+            labels + scoresNumber, 
+            labels + LABEL_VALUES_NUMBER, 
+            [outputs](const size_t &a, const size_t &b) {
+                return outputs[a] > outputs[b];
+            });
+    }
+    for (size_t i = 0; i < scoresNumber; i++) 
+        scores[i] = outputs[labels[i]];
+    log->doneInferScores(
+        inferImageIndex, 
+        imageIndex, 
+        labels, 
+        scores, 
+        scoresNumber);
+}
+
 class Network {
 protected:
+    // ]p̃lbg[Nł̕]Xbhv[̎dɂB
+    // v͈x1󂯕tAwaitŌʂ󂯎B
+    class EvalTask {
+    protected:
+        Network    *network;
+        TaskGroup   group;
+        MNIST      *mnist;
+        size_t      imagesOffset;
+        size_t      imagesNumber;
+        size_t      stride;
+        size_t      phase;
+        size_t      limit;
+        EvalResult  result;
+        
+        static void run(void *context, const size_t &begin, const size_t &end) {
+            auto task = (EvalTask *)context;
+            task->result = task->network->evaluate(
+                task->mnist, 
+                task->imagesOffset, 
+                task->imagesNumber, 
+                task->stride, 
+                task->phase, 
+                task->limit);
+        }
+    public:
+        EvalTask(Network *network) : 
+            network(network) {}
+        
+        ~EvalTask() {
+            getThreadPool()->wait(&this->group);
+        }
+        
+        void request(
+            MNIST        *mnist, 
+            const size_t &imagesOffset, 
+            const size_t &imagesNumber, 
+            const size_t &stride, 
+            const size_t &phase, 
+            const size_t &limit) 
+        {
+            this->mnist        = mnist;
+            this->imagesOffset = imagesOffset;
+            this->imagesNumber = imagesNumber;
+            this->stride       = stride;
+            this->phase        = phase;
+            this->limit        = limit;
+            getThreadPool()->submit(&this->group, &EvalTask::run, this, 0, 0);
+        }
+        
+        EvalResult wait() {
+            getThreadPool()->wait(&this->group);
+            return this->result;
+        }
+    };
+    
+    shared_ptr<Arena>                      arena;
     shared_ptr<vector<shared_ptr<Layer>>>  layers;
+    NetworkMode                            mode;
     HyperParameters                       *hyperParameters;
     shared_ptr<Log>                        log;
+    NotInputLayer                         *outputLayer;
+    shared_ptr<OutputEpilogue>             outputEpilogue;
+    InferencePlan                          inferencePlan;
+    PerfRecorder                           perfRecorder;
+    size_t                                 inferScoresNumber;
+    bool                                   sortsInferScores;
+    shared_ptr<Network>                    evalNetwork;
+    size_t                                 evalEvery;
+    size_t                                 evalSubsample;
+    shared_ptr<RingAllreducer>             allreducer;
+    vector<double>                         allreducedGradients;
+    vector<FullyConnectedLayer *>          prunedLayers;
+    size_t                                 frozenLayersNumber;
+    bool                                   cachesFrozenOutputs;
+    vector<double>                         frozenOutputs;
+    
+    // w̏d݂multiplier|Bo͐̃j[͈̔͂ɕĕɊ|B
+    static void multiplyWeights(FullyConnectedLayer *layer, const double &multiplier) {
+        size_t sourceNeuronsNumber = layer->getSourceNeuronsNumber();
+        double *weights = layer->getWeights();
+        runInParallel(
+            layer->getNeuronsNumber(), 
+            max<size_t>(PLAN_MIN_PARALLEL_MULTIPLY_ADDS / sourceNeuronsNumber, 1), 
+            [&](const size_t &begin, const size_t &end) 
+        {
+            for (auto i = begin * sourceNeuronsNumber; i < end * sourceNeuronsNumber; i++) 
+                weights[i] *= multiplier;
+        });
+    }
     
     void beginEpoch() {
-        for (auto l = this->layers->begin(); l != this->layers->end() - 1; l++) {
-            for (auto n : (*(*l)->getNeurons())) {
-                for (auto os : *n->getOutputSynapses()) 
-                    os->multiplyWeight(invert(negateRatio((*l)->getDropoutRatio())));
-            }
-        }
+        for (auto l = this->layers->begin(); l != this->layers->end() - 1; l++) 
+            multiplyWeights(
+                dynamic_cast<FullyConnectedLayer *>((l + 1)->get()), 
+                invert(negateRatio((*l)->getDropoutRatio())));
     }
     
+    // Ƃj[̌zendBatchœǂ܂Ȃ̂ŁAƂɌz܂Ƃ߂0ɂB
     void beginBatch() {
         for (auto l = this->layers->begin(); l != this->layers->end() - 1; l++) 
             (*l)->dropNeurons();
-        for (auto l = this->layers->begin() + 1; l != this->layers->end(); l++) {
-            for (auto n : (*(*l)->getNeurons())) {
-                if (n->wasDropped()) 
-                    continue;
-                n->clearBiasGradient();
-                for (auto is : *n->getInputSynapses()) {
-                    if (is->getSource()->wasDropped()) 
-                        continue;
-                    is->clearWeightGradient();
-                }
-            }
+        for (auto l = this->layers->begin() + 1 + this->frozenLayersNumber; l != this->layers->end(); l++) {
+            size_t neuronsNumber = (*l)->getNeuronsNumber();
+            auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+            auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+            fill(notInputLayer->getBiasGradients(), notInputLayer->getBiasGradients() + neuronsNumber, 0.0);
+            fill(
+                connectedLayer->getWeightGradients(), 
+                connectedLayer->getWeightGradients() + neuronsNumber * connectedLayer->getSourceNeuronsNumber(), 
+                0.0);
         }
     }
     
-    void propagateForward(Image *image) {
-        auto inputNeurons = this->layers->front()->getNeurons();
+    // wNetworkBuilder͑w̎瑱Ă邱Ƃm߂ĂB
+    static size_t countFrozenLayers(vector<shared_ptr<Layer>> *layers) {
+        return count_if(layers->begin(), layers->end(), [](const shared_ptr<Layer> &l) {
+            return l->isFrozen();
+        });
+    }
+    
+    void setInputs(Image *image) {
+        auto inputLayer = this->layers->front().get();
+        auto dropped = inputLayer->getDroppedMask();
+        auto outputs = inputLayer->getOutputs();
+        auto intensities = image->getIntensities();
         for (auto i = 0; i < IMAGE_AREA; i++) {
-            auto n = (*inputNeurons)[i];
-            if (n->wasDropped()) 
+            if (dropped[i]) 
                 continue;
-            n->setOutput((double)(*image->getIntensities())[i] / 255.0);
+            outputs[i] = (double)intensities[i] / 255.0;
         }
-        for (auto l = this->layers->begin() + 1; l != this->layers->end(); l++) {
-            for (auto n : *(*l)->getNeurons()) {
-                if (n->wasDropped()) 
+    }
+    
+    // o͑w̏o͂outputEpilogueŋ߂̂ŁAo͑wł͓͂߂B
+    // ̘͂a͓͌̏ɑAŌɃoCAX𑫂B
+    // o͐̃j[͈̔͂ɕĕɋ߂BĂʂ͕ςȂB
+    void propagateLayerForward(const vector<shared_ptr<Layer>>::iterator &l) {
+        TraceSpan span("forward", l - this->layers->begin());
+        auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+        auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+        size_t sourceNeuronsNumber = connectedLayer->getSourceNeuronsNumber();
+        const unsigned char *dropped = (*l)->getDroppedMask();
+        const unsigned char *sourceDropped = (*(l - 1))->getDroppedMask();
+        const double *sources = (*(l - 1))->getOutputs();
+        const double *weights = connectedLayer->getWeights();
+        const double *biases = notInputLayer->getBiases();
+        double *inputs = notInputLayer->getInputs();
+        runInParallel(
+            (*l)->getNeuronsNumber(), 
+            max<size_t>(PLAN_MIN_PARALLEL_MULTIPLY_ADDS / sourceNeuronsNumber, 1), 
+            [&](const size_t &begin, const size_t &end) 
+        {
+            for (auto j = begin; j < end; j++) {
+                if (dropped[j]) 
                     continue;
-                n->clearInput();
-                for (auto is : *n->getInputSynapses()) {
-                    auto src = is->getSource();
-                    if (src->wasDropped()) 
+                const double *row = weights + j * sourceNeuronsNumber;
+                double input = 0.0;
+                for (size_t i = 0; i < sourceNeuronsNumber; i++) {
+                    if (sourceDropped[i]) 
                         continue;
-                    n->addInput(is->getWeight() * src->getOutput());
+                    input += row[i] * sources[i];
                 }
-                n->addInput(n->getBias());
-                n->setOutput((*l)->getActivationFunction()->computeOutput(
-                    n->getInput(), 
-                    (*l)->getNeurons()));
+                inputs[j] = input + biases[j];
             }
+        });
+        // Ƃj[̏o͂߂邪Aǂǂ܂ȂB
+        if (l != this->layers->end() - 1) 
+            (*l)->getActivationFunction()->computeOutputs(
+                dynamic_cast<NotInputLayer *>(l->get())->getInputs(), 
+                (*l)->getOutputs(), 
+                (*l)->getNeuronsNumber(), 
+                (*l)->getNeurons());
+    }
+    
+    // o͑woutputEpilogueŏo͂Ɠ߁ARXgcostsSumɑB
+    // computesErrorsȂo͑w̌덷߂B
+    // frozenOutputsΓŌ̑w̏o͂ɂāA̎̑w狁߂B
+    size_t propagateForward(
+        Image        *image, 
+        const size_t &label, 
+        double       *costsSum, 
+        const bool   &computesErrors, 
+        const double *frozenOutputs = nullptr) 
+    {
+        auto firstLayer = this->layers->begin() + 1;
+        if (frozenOutputs) {
+            auto frozenLayer = this->layers->begin() + this->frozenLayersNumber;
+            copy(frozenOutputs, frozenOutputs + (*frozenLayer)->getNeuronsNumber(), (*frozenLayer)->getOutputs());
+            firstLayer = frozenLayer + 1;
+        } else 
+            setInputs(image);
+        for (auto l = firstLayer; l != this->layers->end(); l++) 
+            propagateLayerForward(l);
+        return this->outputEpilogue->run(
+            this->outputLayer->getInputs(), 
+            this->outputLayer->getOutputs(), 
+            computesErrors ? this->outputLayer->getErrors() : nullptr, 
+            this->outputLayer->getNeuronsNumber(), 
+            label, 
+            costsSum);
+    }
+    
+    // 摜̂phaseԖڂstrideƂɍőlimit]B
+    // RXg̍vɂ͐̍܂߂ȂB
+    EvalResult evaluate(
+        MNIST        *mnist, 
+        const size_t &imagesOffset, 
+        const size_t &imagesNumber, 
+        const size_t &stride, 
+        const size_t &phase, 
+        const size_t &limit) 
+    {
+        TraceSpan span("eval");
+        EvalResult result = {0, 0.0, 0};
+        this->perfRecorder.enter(PERF_EVAL);
+        for (auto j = phase; j < imagesNumber && result.imagesNumber < limit; j += stride) {
+            auto image = (*mnist)[imagesOffset + j].get();
+            size_t label = image->getLabel();
+            if (this->inferencePlan.run(image, this->outputEpilogue.get(), label, &result.costsSum) == label) 
+                result.correctAnswersNumber++;
+            result.imagesNumber++;
         }
+        this->perfRecorder.leave();
+        return result;
     }
     
-    size_t getAnswer() {
-        size_t answer = 0;
-        double maxOutput = 0.0;
-        auto outputNeurons = this->layers->back()->getNeurons();
-        for (auto i = 0; i < outputNeurons->size(); i++) {
-            double o = (*outputNeurons)[i]->getOutput();
-            if (o > maxOutput) {
-                answer = i;
-                maxOutput = o;
-            }
+    void putScores(const size_t &inferImageIndex, const size_t &imageIndex) {
+        putInferScores(
+            this->log.get(), 
+            inferImageIndex, 
+            imageIndex, 
+            this->inferencePlan.getOutputs(), 
+            this->inferScoresNumber, 
+            this->sortsInferScores);
+    }
+    
+    static void copyLayerParameters(Layer *layer, Layer *sourceLayer) {
+        if (layer->getNeuronsNumber() != sourceLayer->getNeuronsNumber()) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "lbg[N̍\Ⴂ܂B");
+        auto notInputLayer = dynamic_cast<NotInputLayer *>(layer);
+        auto sourceNotInputLayer = dynamic_cast<NotInputLayer *>(sourceLayer);
+        if (notInputLayer && sourceNotInputLayer) 
+            copy(
+                sourceNotInputLayer->getBiases(), 
+                sourceNotInputLayer->getBiases() + layer->getNeuronsNumber(), 
+                notInputLayer->getBiases());
+        auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(layer);
+        auto sourceConnectedLayer = dynamic_cast<FullyConnectedLayer *>(sourceLayer);
+        if (connectedLayer && sourceConnectedLayer) 
+            copy(
+                sourceConnectedLayer->getWeights(), 
+                sourceConnectedLayer->getWeights() + 
+                    layer->getNeuronsNumber() * sourceConnectedLayer->getSourceNeuronsNumber(), 
+                connectedLayer->getWeights());
+    }
+    
+    // P̉摜ƂɓŌ̑w̏o͂߂ĂB
+    // w̃p[^͕ς炸AhbvAEgȂ̂ŁA摜Ƃɖ񓯂o͂ɂȂB
+    void cacheFrozenOutputs(
+        MNIST        *mnist, 
+        const size_t &imagesOffset, 
+        const size_t &imagesNumber) 
+    {
+        TraceSpan span("cacheFrozenOutputs");
+        auto frozenLayer = this->layers->begin() + this->frozenLayersNumber;
+        size_t neuronsNumber = (*frozenLayer)->getNeuronsNumber();
+        this->frozenOutputs.resize(imagesNumber * neuronsNumber);
+        for (size_t i = 0; i < imagesNumber; i++) {
+            setInputs((*mnist)[imagesOffset + i].get());
+            for (auto l = this->layers->begin() + 1; l != frozenLayer + 1; l++) 
+                propagateLayerForward(l);
+            copy(
+                (*frozenLayer)->getOutputs(), 
+                (*frozenLayer)->getOutputs() + neuronsNumber, 
+                &this->frozenOutputs[i * neuronsNumber]);
         }
-        return answer;
     }
     
-    double computeImageCost(const size_t &label) {
-        double costsSum = 0.0;
-        auto outputNeurons = this->layers->back()->getNeurons();
-        for (auto i = 0; i < outputNeurons->size(); i++) 
-            costsSum += this->hyperParameters->costFunction->computeOutputNeuronCost(
-                (*outputNeurons)[i].get(), 
-                getDesiredOutput(i, label));
-        return costsSum;
-    }
-    
-    void propagateBackward(const size_t &label) {
-        for (auto l = this->layers->rbegin(); l != this->layers->rend() - 1; l++) {
-            if (l == this->layers->rbegin()) {
-                for (auto i = 0; i < (*l)->getNeurons()->size(); i++) {
-                    auto n = (*(*l)->getNeurons())[i];
-                    n->setError(this->hyperParameters->costFunction->computeOutputNeuronError(
-                        n.get(), 
-                        getDesiredOutput(i, label), 
-                        (*l)->getActivationFunction(), 
-                        (*l)->getNeurons()));
-                }
-            } else {
-                for (auto n : (*(*l)->getNeurons())) {
-                    if (n->wasDropped()) 
+    // ̑w̌덷w̌덷߂Bj[͈̔͂ɕĕɋ߂B
+    // ̑w̏d݂͍sƂɓǂ݁A덷̘a̓j[Ƃɏo͐̏ɑBĂʂ͕ςȂB
+    // Ƃj[̌덷ɂaAǂǂ܂ȂB
+    void propagateLayerErrors(const vector<shared_ptr<Layer>>::iterator &l) {
+        auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+        auto nextNotInputLayer = dynamic_cast<NotInputLayer *>((l + 1)->get());
+        auto nextConnectedLayer = dynamic_cast<FullyConnectedLayer *>((l + 1)->get());
+        size_t neuronsNumber = (*l)->getNeuronsNumber();
+        size_t nextNeuronsNumber = (*(l + 1))->getNeuronsNumber();
+        auto activationFunction = (*l)->getActivationFunction();
+        auto neurons = (*l)->getNeurons();
+        const unsigned char *dropped = (*l)->getDroppedMask();
+        const unsigned char *nextDropped = (*(l + 1))->getDroppedMask();
+        const double *inputs = notInputLayer->getInputs();
+        const double *outputs = (*l)->getOutputs();
+        const double *nextWeights = nextConnectedLayer->getWeights();
+        const double *nextErrors = nextNotInputLayer->getErrors();
+        double *errors = notInputLayer->getErrors();
+        runInParallel(
+            neuronsNumber, 
+            max<size_t>(PLAN_MIN_PARALLEL_MULTIPLY_ADDS / nextNeuronsNumber, 1), 
+            [&](const size_t &begin, const size_t &end) 
+        {
+            fill(errors + begin, errors + end, 0.0);
+            for (size_t j = 0; j < nextNeuronsNumber; j++) {
+                if (nextDropped[j]) 
+                    continue;
+                const double *row = nextWeights + j * neuronsNumber;
+                double nextError = nextErrors[j];
+                for (auto i = begin; i < end; i++) 
+                    errors[i] += row[i] * nextError;
+            }
+            for (auto i = begin; i < end; i++) {
+                if (dropped[i]) 
+                    continue;
+                errors[i] *= activationFunction->computeDifferentialOutput(inputs[i], outputs[i], neurons);
+            }
+        });
+    }
+    
+    // w̌덷Ɠ͌̏o͂z𑫂Bo͐̃j[͈̔͂ɕĕɑB
+    void addLayerGradients(const vector<shared_ptr<Layer>>::iterator &l) {
+        auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+        auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+        size_t sourceNeuronsNumber = connectedLayer->getSourceNeuronsNumber();
+        const unsigned char *dropped = (*l)->getDroppedMask();
+        const unsigned char *sourceDropped = (*(l - 1))->getDroppedMask();
+        const double *sources = (*(l - 1))->getOutputs();
+        const double *errors = notInputLayer->getErrors();
+        double *biasGradients = notInputLayer->getBiasGradients();
+        double *weightGradients = connectedLayer->getWeightGradients();
+        runInParallel(
+            (*l)->getNeuronsNumber(), 
+            max<size_t>(PLAN_MIN_PARALLEL_MULTIPLY_ADDS / sourceNeuronsNumber, 1), 
+            [&](const size_t &begin, const size_t &end) 
+        {
+            for (auto j = begin; j < end; j++) {
+                if (dropped[j]) 
+                    continue;
+                double error = errors[j];
+                biasGradients[j] += error;
+                double *row = weightGradients + j * sourceNeuronsNumber;
+                for (size_t i = 0; i < sourceNeuronsNumber; i++) {
+                    if (sourceDropped[i]) 
                         continue;
-                    double error = 0.0;
-                    for (auto os : *n->getOutputSynapses()) {
-                        auto dest = os->getDestination();
-                        if (dest->wasDropped()) 
-                            continue;
-                        error += os->getWeight() * dest->getError();
-                    }
-                    error *= (*l)->getActivationFunction()->computeDifferentialOutput(
-                        n->getInput(), 
-                        (*l)->getNeurons());
-                    n->setError(error);
+                    row[i] += sources[i] * error;
                 }
             }
-            for (auto n : (*(*l)->getNeurons())) {
-                if (n->wasDropped()) 
+        });
+    }
+    
+    // o͑w̌덷propagateForwardŋ߂ĂB
+    // w̃p[^͍XVȂ̂ŁǍzƁAɓ`덷͋߂ȂB
+    void propagateBackward() {
+        auto firstLayer = this->layers->begin() + 1 + this->frozenLayersNumber;
+        for (auto l = this->layers->end() - 1; l >= firstLayer; l--) {
+            TraceSpan span("backward", l - this->layers->begin());
+            if (l != this->layers->end() - 1) 
+                propagateLayerErrors(l);
+            addLayerGradients(l);
+        }
+    }
+    
+    // SĂ̏ʂ̌z1̔zɋl߂Ęa߁Aς߂B
+    // ʂ͓̏Ԃn߂̂ŁAƂj[SĂ̏ʂœɂȂB
+    void allreduceGradients() {
+        auto gradients = this->allreducedGradients.begin();
+        for (auto l = this->layers->begin() + 1 + this->frozenLayersNumber; l != this->layers->end(); l++) {
+            size_t neuronsNumber = (*l)->getNeuronsNumber();
+            auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+            gradients = copy(notInputLayer->getBiasGradients(), notInputLayer->getBiasGradients() + neuronsNumber, gradients);
+            auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+            if (connectedLayer) 
+                gradients = copy(
+                    connectedLayer->getWeightGradients(), 
+                    connectedLayer->getWeightGradients() + neuronsNumber * connectedLayer->getSourceNeuronsNumber(), 
+                    gradients);
+        }
+        this->allreducer->allreduce(&this->allreducedGradients[0], this->allreducedGradients.size());
+        double ratio = invert((double)this->allreducer->getRanksNumber());
+        gradients = this->allreducedGradients.begin();
+        for (auto l = this->layers->begin() + 1 + this->frozenLayersNumber; l != this->layers->end(); l++) {
+            size_t neuronsNumber = (*l)->getNeuronsNumber();
+            auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+            for (size_t i = 0; i < neuronsNumber; i++) 
+                notInputLayer->getBiasGradients()[i] = ratio * *gradients++;
+            auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+            if (connectedLayer) {
+                for (size_t i = 0; i < neuronsNumber * connectedLayer->getSourceNeuronsNumber(); i++) 
+                    connectedLayer->getWeightGradients()[i] = ratio * *gradients++;
+            }
+        }
+    }
+    
+    // o͐̃j[͈̔͂ɕĕɍXVB
+    void updateLayerParameters(
+        const vector<shared_ptr<Layer>>::iterator &l, 
+        const double                              &outputLearningRate, 
+        const double                              &inputLearningRate, 
+        const size_t                              &imagesNumber) 
+    {
+        auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+        auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+        size_t sourceNeuronsNumber = connectedLayer->getSourceNeuronsNumber();
+        auto regularization = this->hyperParameters->regularization;
+        double weightDecayRate = this->hyperParameters->weightDecayRate;
+        const unsigned char *dropped = (*l)->getDroppedMask();
+        const unsigned char *sourceDropped = (*(l - 1))->getDroppedMask();
+        const double *biasGradients = notInputLayer->getBiasGradients();
+        const double *weightGradients = connectedLayer->getWeightGradients();
+        double *biases = notInputLayer->getBiases();
+        double *weights = connectedLayer->getWeights();
+        runInParallel(
+            (*l)->getNeuronsNumber(), 
+            max<size_t>(PLAN_MIN_PARALLEL_MULTIPLY_ADDS / sourceNeuronsNumber, 1), 
+            [&](const size_t &begin, const size_t &end) 
+        {
+            for (auto j = begin; j < end; j++) {
+                if (dropped[j]) 
                     continue;
-                n->addBiasGradient(n->getError());
-                for (auto is : *n->getInputSynapses()) {
-                    auto src = is->getSource();
-                    if (src->wasDropped()) 
+                biases[j] = biases[j] - outputLearningRate * biasGradients[j];
+                double *row = weights + j * sourceNeuronsNumber;
+                const double *gradientsRow = weightGradients + j * sourceNeuronsNumber;
+                for (size_t i = 0; i < sourceNeuronsNumber; i++) {
+                    if (sourceDropped[i]) 
                         continue;
-                    is->addWeightGradient(src->getOutput() * n->getError());
+                    row[i] = 
+                        regularization->computeDecayedWeight(
+                            row[i], 
+                            inputLearningRate, 
+                            weightDecayRate, 
+                            imagesNumber) - 
+                        inputLearningRate * gradientsRow[i];
                 }
             }
-        }
+        });
     }
     
     void endBatch(const size_t &imagesNumber, const size_t &batchSize) {
+        if (this->allreducer) 
+            allreduceGradients();
         double imageLearningRate = 
             this->hyperParameters->learningRate / 
             (double)batchSize;
-        for (auto l = this->layers->begin() + 1; l != this->layers->end(); l++) {
+        for (auto l = this->layers->begin() + 1 + this->frozenLayersNumber; l != this->layers->end(); l++) {
             double outputLearningRate = 
                 imageLearningRate * 
                 invert(negateRatio((*l)->getDropoutRatio()));
             double inputLearningRate = 
                 outputLearningRate * 
                 invert(negateRatio((*(l - 1))->getDropoutRatio()));
-            for (auto n : (*(*l)->getNeurons())) {
-                if (n->wasDropped()) 
-                    continue;
-                n->setBias(
-                    n->getBias() - 
-                    outputLearningRate * n->getBiasGradient());
-                for (auto is : *n->getInputSynapses()) {
-                    if (is->getSource()->wasDropped())
-                        continue;
-                    is->setWeight(
-                        this->hyperParameters->regularization->computeDecayedWeight(
-                            is->getWeight(), 
-                            inputLearningRate, 
-                            this->hyperParameters->weightDecayRate, 
-                            imagesNumber) - 
-                        inputLearningRate * is->getWeightGradient());
-                }
-            }
+            updateLayerParameters(l, outputLearningRate, inputLearningRate, imagesNumber);
         }
+        for (auto l : this->prunedLayers) 
+            l->clearPrunedWeights();
         for (auto l = this->layers->begin(); l != this->layers->end() - 1; l++) 
             (*l)->restoreNeurons();
     }
     
     void endEpoch() {
-        for (auto l = this->layers->begin(); l != this->layers->end() - 1; l++) {
-            for (auto n : (*(*l)->getNeurons())) {
-                for (auto os : *n->getOutputSynapses()) 
-                    os->multiplyWeight(negateRatio((*l)->getDropoutRatio()));
-            }
-        }
+        for (auto l = this->layers->begin(); l != this->layers->end() - 1; l++) 
+            multiplyWeights(
+                dynamic_cast<FullyConnectedLayer *>((l + 1)->get()), 
+                negateRatio((*l)->getDropoutRatio()));
     }
     
-    static double getDesiredOutput(const size_t &index, const size_t &label) {
-        return index == label ? 1.0 : 0.0;
+    void inferImage(
+        Image        *image, 
+        const size_t &inferImageIndex, 
+        size_t       *correctAnswersNumber, 
+        double       *costsSum) 
+    {
+        size_t label = image->getLabel();
+        size_t answer = this->inferencePlan.run(image, this->outputEpilogue.get(), label, costsSum);
+        if (answer == label) 
+            (*correctAnswersNumber)++;
+        this->log->doneInferImage(
+            inferImageIndex, 
+            image->getIndex(), 
+            label, 
+            answer);
+        if (this->inferScoresNumber != 0) 
+            putScores(inferImageIndex, image->getIndex());
+    }
+    
+    void endInfer(
+        const size_t &correctAnswersNumber, 
+        const double &costsSum, 
+        const size_t &imagesNumber) 
+    {
+        this->log->doneInfer(
+            correctAnswersNumber, 
+            (costsSum + computeWeightsCost()) / (double)imagesNumber);
     }
 public:
+    // arenaɂInferencePlan::computeArenaSize̋̕󂫂΂ȂȂB
     Network(
+        const shared_ptr<Arena>                     &arena, 
         const shared_ptr<vector<shared_ptr<Layer>>> &layers, 
+        const NetworkMode                           &mode, 
         HyperParameters                             *hyperParameters, 
         const shared_ptr<Log>                       &log) : 
-            layers         (layers), 
-            hyperParameters(hyperParameters), 
-            log            (log) {}
+            arena              (arena), 
+            layers             (layers), 
+            mode               (mode), 
+            hyperParameters    (hyperParameters), 
+            log                (log), 
+            outputLayer        (dynamic_cast<NotInputLayer *>(layers->back().get())), 
+            outputEpilogue     (newOutputEpilogue(
+                layers->back()->getActivationFunction(), 
+                hyperParameters->costFunction)), 
+            inferencePlan      (arena.get(), layers.get(), mode == INFERENCE_MODE), 
+            inferScoresNumber  (0), 
+            sortsInferScores   (false), 
+            evalEvery          (1), 
+            evalSubsample      (0), 
+            frozenLayersNumber (countFrozenLayers(layers.get())), 
+            cachesFrozenOutputs(false) {}
+    
+    // ]̉摜SĐ肵A̐ƃRXg̘a߂BO͏o͂ȂB
+    EvalResult evaluate(
+        MNIST        *mnist, 
+        const size_t &imagesOffset, 
+        const size_t &imagesNumber) 
+    {
+        return evaluate(mnist, imagesOffset, imagesNumber, 1, 0, imagesNumber);
+    }
+    
+    // 肵摜Ƃɏo͑w̏o͂doneInferScoresɓn悤ɂB
+    // sortedȂ傫scoresNumberAłȂ΃x̏ɑSāB
+    // scoresNumber0ȂnȂB
+    void setInferScores(const size_t &scoresNumber, const bool &sorted) {
+        if (scoresNumber > LABEL_VALUES_NUMBER) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "o͂̐", LABEL_VALUES_NUMBER, "ȉłȂ΂Ȃ܂B");
+        this->inferScoresNumber = scoresNumber;
+        this->sortsInferScores  = sorted;
+    }
+    
+    // P̕]̎d߂B
+    // evalNetworkΐ̏Ȉd݂ɎʂA̐PȂXbhv[ŕ]B
+    // evalEveryゲƂƍŌ̐ゾ]AevalSubsample0łȂ΂̖ԊuɑIŕ]B
+    void setEvaluation(
+        const shared_ptr<Network> &evalNetwork, 
+        const size_t              &evalEvery, 
+        const size_t              &evalSubsample) 
+    {
+        if (evalEvery == 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "]̊Ԋu1ȏłȂ΂Ȃ܂B");
+        this->evalNetwork   = evalNetwork;
+        this->evalEvery     = evalEvery;
+        this->evalSubsample = evalSubsample;
+    }
+    
+    // allreducer̊̑SĂ̏ʂŁAob`ƂɌz̕ς߂Ăp[^XVB
+    // P̐̐ƃRXgSĂ̏ʂ̘aɂB
+    void setAllreducer(const shared_ptr<RingAllreducer> &allreducer) {
+        size_t gradientsNumber = 0;
+        for (auto l = this->layers->begin() + 1 + this->frozenLayersNumber; l != this->layers->end(); l++) {
+            gradientsNumber += (*l)->getNeuronsNumber();
+            auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+            if (connectedLayer) 
+                gradientsNumber += (*l)->getNeuronsNumber() * connectedLayer->getSourceNeuronsNumber();
+        }
+        this->allreducer = allreducer;
+        this->allreducedGradients.assign(allreducer ? gradientsNumber : 0, 0.0);
+    }
+    
+    // w΁AP̎n߂ɉ摜ƂɓŌ̑w̏o͂߂ĂA
+    // ゲƂɂ͓ĂȂw`dB
+    // o͂񓯂łȂ΂ȂȂ̂ŁA͑wƓw̓hbvAEgĂ͂ȂȂB
+    void setCachesFrozenOutputs(const bool &cachesFrozenOutputs) {
+        if (cachesFrozenOutputs && this->frozenLayersNumber != 0) {
+            for (size_t i = 0; i <= this->frozenLayersNumber; i++) {
+                if ((*this->layers)[i]->getDropoutRatio() != 0.0) 
+                    throw describe(__FILE__, "(", __LINE__, "): " , "w̏o͂LbVȂA͑wƓw̃hbvAEg0łȂ΂Ȃ܂B");
+            }
+        }
+        this->cachesFrozenOutputs = cachesFrozenOutputs;
+    }
+    
+    // wƂɐΒl̏ɏd݂sparsitẙ0ɂAwƂdonePruneo͂B
+    // 0ɂd݂́ǍɌPĂ0̂܂܂ɂB
+    void prune(const double &sparsity) {
+        this->prunedLayers.clear();
+        for (auto l = this->layers->begin() + 1; l != this->layers->end(); l++) {
+            auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+            if (!connectedLayer) 
+                continue;
+            size_t synapsesNumber = (*l)->getNeuronsNumber() * connectedLayer->getSourceNeuronsNumber();
+            size_t nonzeroWeightsNumber = connectedLayer->pruneWeights(sparsity);
+            this->log->donePrune(l - this->layers->begin(), synapsesNumber, nonzeroWeightsNumber);
+            this->prunedLayers.push_back(connectedLayer);
+        }
+        this->inferencePlan.refresh();
+    }
+    
+    // sourcẽp[^ʂBw̍\͓łȂ΂ȂȂB
+    void copyParameters(Network *source) {
+        if (this->layers->size() != source->layers->size()) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "lbg[N̍\Ⴂ܂B");
+        for (auto i = 1; i < this->layers->size(); i++) 
+            copyLayerParameters((*this->layers)[i].get(), (*source->layers)[i].get());
+        this->inferencePlan.refresh();
+    }
+    
+    // BwƂɏdْ݂lBw̔ԍ(͑w0Ƃ)番ւ̕\ԂB
+    map<size_t, shared_ptr<LowRankFactorization>> factorizeHiddenLayers() {
+        map<size_t, shared_ptr<LowRankFactorization>> factorizations;
+        for (auto i = 1; i < this->layers->size() - 1; i++) {
+            auto hiddenLayer = dynamic_cast<FullyConnectedHiddenLayer *>((*this->layers)[i].get());
+            if (hiddenLayer) 
+                factorizations[i] = newInstance<LowRankFactorization>(
+                    hiddenLayer->getWeights(), 
+                    hiddenLayer->getNeuronsNumber(), 
+                    hiddenLayer->getSourceNeuronsNumber());
+        }
+        return factorizations;
+    }
+    
+    // sourcẽp[^ʂBranksɂsourcȇẃȂOɋ񂾐`̑wƍ킹ĊK𗎂ƂߎʂB
+    // ̃lbg[Nsource̒`insertLowRankLayersœranks̑w񂾂̂łȂ΂ȂȂB
+    void copyFactorizedParameters(
+        Network                                             *source, 
+        const map<size_t, shared_ptr<LowRankFactorization>> &factorizations, 
+        const map<size_t, size_t>                           &ranks) 
+    {
+        if (this->layers->size() != source->layers->size() + ranks.size()) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "lbg[N̍\Ⴂ܂B");
+        auto l = this->layers->begin() + 1;
+        for (auto i = 1; i < source->layers->size(); i++) {
+            auto sourceLayer = (*source->layers)[i].get();
+            if (ranks.count(i) != 0) {
+                size_t rank = ranks.at(i);
+                auto firstLayer = dynamic_cast<FullyConnectedHiddenLayer *>((l++)->get());
+                auto secondLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+                if (!firstLayer || 
+                    firstLayer->getNeuronsNumber() != rank || 
+                    !secondLayer) 
+                    throw describe(__FILE__, "(", __LINE__, "): " , "lbg[N̍\Ⴂ܂B");
+                fill(firstLayer->getBiases(), firstLayer->getBiases() + rank, 0.0);
+                factorizations.at(i)->computeFactors(rank, firstLayer->getWeights(), secondLayer->getWeights());
+                auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+                auto sourceNotInputLayer = dynamic_cast<NotInputLayer *>(sourceLayer);
+                copy(
+                    sourceNotInputLayer->getBiases(), 
+                    sourceNotInputLayer->getBiases() + sourceLayer->getNeuronsNumber(), 
+                    notInputLayer->getBiases());
+            } else {
+                copyLayerParameters(l->get(), sourceLayer);
+            }
+            l++;
+        }
+        this->inferencePlan.refresh();
+    }
     
     void train(
         const size_t   &epochsNumber, 
@@ -253,71 +847,179 @@ public:
         const size_t   &evalImagesOffset, 
         const size_t   &evalImagesNumber) 
     {
+        if (this->mode != TRAINING_MODE) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "_pɍ\zlbg[N͌Pł܂B");
         size_t totalTrainCorrectAnswersNumber = 0;
         double totalTrainCostsSum             = 0.0;
         size_t totalEvalCorrectAnswersNumber  = 0;
         double totalEvalCostsSum              = 0.0;
+        size_t totalEvalImagesNumber          = 0;
+        // allreducer΁AP̉摜͑SĂ̏ʂ̕킹ŐB
+        size_t allTrainImagesNumber = trainImagesNumber * (this->allreducer ? this->allreducer->getRanksNumber() : 1);
         vector<size_t> imageIndices(trainImagesNumber);
+        size_t firstAllocationsNumber = 0;
+        size_t evalLimit = this->evalSubsample == 0 ? 
+            evalImagesNumber : 
+            min(this->evalSubsample, evalImagesNumber);
+        size_t evalStride = evalLimit == 0 ? 1 : max<size_t>(evalImagesNumber / evalLimit, 1);
+        shared_ptr<EvalTask> evalTask;
+        if (this->evalNetwork) 
+            evalTask = newInstance<EvalTask>(this->evalNetwork.get());
+        this->frozenOutputs.clear();
+        if (this->cachesFrozenOutputs && this->frozenLayersNumber != 0) 
+            cacheFrozenOutputs(trainingMNIST, trainImagesOffset, trainImagesNumber);
+        size_t frozenNeuronsNumber = (*this->layers)[this->frozenLayersNumber]->getNeuronsNumber();
+        bool   evalPending                      = false;
+        size_t pendingEpochIndex                = 0;
+        size_t pendingTrainCorrectAnswersNumber = 0;
+        double pendingTrainCostsSum             = 0.0;
+        double pendingWeightsCost               = 0.0;
+        PerfCounts pendingPerfCounts            = {};
+        
+        // ̍͐̏IɈx߁APƕ]̃RXg̗ɑB
+        // ]͐̏Ȉd݂̎ʂōŝŁA͓lɂȂB
+        // ]̒iǨv͕]lbg[N̋L^B
+        auto putEpoch = [&](
+            const size_t     &epochIndex, 
+            const size_t     &trainCorrectAnswersNumber, 
+            const double     &trainCostsSum, 
+            const double     &weightsCost, 
+            PerfCounts        perfCounts, 
+            const EvalResult &evalResult) 
+        {
+            if (PerfCounters::getInstance()->isOpen()) {
+                auto evalNetwork = this->evalNetwork ? this->evalNetwork.get() : this;
+                auto evalPerfCounts = evalNetwork->perfRecorder.take();
+                copy(
+                    evalPerfCounts.values[PERF_EVAL], 
+                    evalPerfCounts.values[PERF_EVAL] + PERF_COUNTERS_NUMBER, 
+                    perfCounts.values[PERF_EVAL]);
+                perfCounts.enabledTimes[PERF_EVAL] = evalPerfCounts.enabledTimes[PERF_EVAL];
+                perfCounts.runningTimes[PERF_EVAL] = evalPerfCounts.runningTimes[PERF_EVAL];
+                for (size_t p = 0; p < PERF_PHASES_NUMBER; p++) {
+                    uint64_t values[PERF_COUNTERS_NUMBER];
+                    if (scalePerfCounts(perfCounts, p, values)) 
+                        this->log->donePerfPhase(epochIndex, p, values);
+                }
+            }
+            double evalCostsSum = evalResult.imagesNumber == 0 ? 
+                0.0 : 
+                evalResult.costsSum + weightsCost;
+            this->log->doneTrainEpoch(
+                epochIndex, 
+                trainCorrectAnswersNumber, 
+                (trainCostsSum + weightsCost) / (double)allTrainImagesNumber, 
+                evalResult.correctAnswersNumber, 
+                evalResult.imagesNumber == 0 ? 
+                    0.0 : 
+                    evalCostsSum / (double)evalResult.imagesNumber);
+            totalTrainCorrectAnswersNumber += trainCorrectAnswersNumber;
+            totalTrainCostsSum             += trainCostsSum + weightsCost;
+            totalEvalCorrectAnswersNumber  += evalResult.correctAnswersNumber;
+            totalEvalCostsSum              += evalCostsSum;
+            totalEvalImagesNumber          += evalResult.imagesNumber;
+        };
+        
         for (auto i = 0; i < epochsNumber; i++) {
+            TraceSpan epochSpan("epoch", i);
+            TraceSpan batchSpan;
             size_t epochTrainCorrectAnswersNumber = 0;
             double epochTrainCostsSum = 0.0;
+            this->perfRecorder.enter(PERF_UPDATE);
             beginEpoch();
+            this->perfRecorder.enter(PERF_DATA);
             for (auto j = 0; j < trainImagesNumber; j++) 
                 imageIndices[j] = trainImagesOffset + j;
             for (auto j = 0;; j++) {
                 if (j % batchSize == 0 || j == trainImagesNumber) {
+                    this->perfRecorder.enter(PERF_UPDATE);
                     if (j != 0) 
-                        endBatch(trainImagesNumber, batchSize);
+                        endBatch(allTrainImagesNumber, batchSize);
+                    batchSpan.end();
+                    if (i == 0 && j == min<size_t>(batchSize, trainImagesNumber)) 
+                        firstAllocationsNumber = getHeapAllocationsNumber()->load();
                     if (j == trainImagesNumber) 
                         break;
+                    batchSpan.start("batch", j / batchSize);
                     beginBatch();
                 }
+                this->perfRecorder.enter(PERF_DATA);
                 size_t k = Random::getInstance()->uniformDistribution<size_t>(
                     0, trainImagesNumber - j - 1);
                 size_t imageIndex = imageIndices[k];
-                propagateForward((*trainingMNIST)[imageIndex].get());
                 size_t label = (*trainingMNIST)[imageIndex]->getLabel();
-                if (getAnswer() == label) 
-                    epochTrainCorrectAnswersNumber++;
-                epochTrainCostsSum += computeImageCost(label);
-                propagateBackward(label);
                 imageIndices[k] = imageIndices[trainImagesNumber - j - 1];
+                const double *frozenOutputs = this->frozenOutputs.empty() ? 
+                    nullptr : 
+                    &this->frozenOutputs[(imageIndex - trainImagesOffset) * frozenNeuronsNumber];
+                this->perfRecorder.enter(PERF_FORWARD);
+                if (propagateForward((*trainingMNIST)[imageIndex].get(), label, &epochTrainCostsSum, true, frozenOutputs) == label) 
+                    epochTrainCorrectAnswersNumber++;
+                this->perfRecorder.enter(PERF_BACKWARD);
+                propagateBackward();
             }
             endEpoch();
-            epochTrainCostsSum += this->hyperParameters->regularization->computeWeightsCost(
-                this->layers.get(), 
-                this->hyperParameters->weightDecayRate);
-            
-            size_t epochEvalCorrectAnswersNumber = 0;
-            double epochEvalCostsSum = 0.0;
-            for (auto j = 0; j < evalImagesNumber; j++) {
-                propagateForward((*evalMNIST)[j].get());
-                size_t label = (*evalMNIST)[j]->getLabel();
-                if (getAnswer() == label) 
-                    epochEvalCorrectAnswersNumber++;
-                epochEvalCostsSum += computeImageCost(label);
+            if (this->allreducer) {
+                double epochSums[] = {(double)epochTrainCorrectAnswersNumber, epochTrainCostsSum};
+                this->allreducer->allreduce(epochSums, 2);
+                epochTrainCorrectAnswersNumber = (size_t)epochSums[0];
+                epochTrainCostsSum             = epochSums[1];
             }
-            epochEvalCostsSum += this->hyperParameters->regularization->computeWeightsCost(
-                this->layers.get(), 
-                this->hyperParameters->weightDecayRate);
-            
-            this->log->doneTrainEpoch(
-                i, 
-                epochTrainCorrectAnswersNumber, 
-                epochTrainCostsSum / (double)trainImagesNumber, 
-                epochEvalCorrectAnswersNumber, 
-                epochEvalCostsSum  / (double)evalImagesNumber);
+            double weightsCost = computeWeightsCost();
+            this->perfRecorder.leave();
+            PerfCounts perfCounts = this->perfRecorder.take();
             
-            totalTrainCorrectAnswersNumber += epochTrainCorrectAnswersNumber;
-            totalTrainCostsSum             += epochTrainCostsSum;
-            totalEvalCorrectAnswersNumber  += epochEvalCorrectAnswersNumber;
-            totalEvalCostsSum              += epochEvalCostsSum;
+            if (evalPending) {
+                putEpoch(
+                    pendingEpochIndex, 
+                    pendingTrainCorrectAnswersNumber, 
+                    pendingTrainCostsSum, 
+                    pendingWeightsCost, 
+                    pendingPerfCounts, 
+                    evalTask->wait());
+                evalPending = false;
+            }
+            if ((i + 1) % this->evalEvery != 0 && i + 1 != epochsNumber) {
+                putEpoch(i, epochTrainCorrectAnswersNumber, epochTrainCostsSum, weightsCost, perfCounts, {0, 0.0, 0});
+                continue;
+            }
+            size_t evalPhase = (i / this->evalEvery) % evalStride;
+            if (!evalTask) {
+                putEpoch(
+                    i, 
+                    epochTrainCorrectAnswersNumber, 
+                    epochTrainCostsSum, 
+                    weightsCost, 
+                    perfCounts, 
+                    evaluate(evalMNIST, evalImagesOffset, evalImagesNumber, evalStride, evalPhase, evalLimit));
+                continue;
+            }
+            this->evalNetwork->copyParameters(this);
+            evalTask->request(evalMNIST, evalImagesOffset, evalImagesNumber, evalStride, evalPhase, evalLimit);
+            evalPending                      = true;
+            pendingEpochIndex                = i;
+            pendingTrainCorrectAnswersNumber = epochTrainCorrectAnswersNumber;
+            pendingTrainCostsSum             = epochTrainCostsSum;
+            pendingWeightsCost               = weightsCost;
+            pendingPerfCounts                = perfCounts;
         }
+        if (evalPending) 
+            putEpoch(
+                pendingEpochIndex, 
+                pendingTrainCorrectAnswersNumber, 
+                pendingTrainCostsSum, 
+                pendingWeightsCost, 
+                pendingPerfCounts, 
+                evalTask->wait());
         this->log->doneTrain(
             totalTrainCorrectAnswersNumber, 
-            totalTrainCostsSum / ((double)epochsNumber * (double)trainImagesNumber), 
+            totalTrainCostsSum / ((double)epochsNumber * (double)allTrainImagesNumber), 
             totalEvalCorrectAnswersNumber, 
-            totalEvalCostsSum  / ((double)epochsNumber * (double)evalImagesNumber));
+            totalEvalImagesNumber == 0 ? 
+                0.0 : 
+                totalEvalCostsSum / (double)totalEvalImagesNumber);
+        this->log->doneCountAllocations(
+            getHeapAllocationsNumber()->load() - firstAllocationsNumber);
     }
     
     void infer(
@@ -325,45 +1027,115 @@ public:
         const size_t &imagesOffset, 
         const size_t &imagesNumber)
     {
+        if (imagesNumber == 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "肷摜܂B");
         size_t correctAnswersNumber = 0;
         double costsSum = 0.0;
+        size_t firstAllocationsNumber = 0;
+        TraceSpan span("infer");
         for (auto i = 0; i < imagesNumber; i++) {
+            if (i == 1) 
+                firstAllocationsNumber = getHeapAllocationsNumber()->load();
             size_t imageIndex = imagesOffset + i;
-            propagateForward((*mnist)[i].get());
-            size_t label = (*mnist)[i]->getLabel();
-            if (getAnswer() == label) 
-                correctAnswersNumber++;
-            costsSum += computeImageCost(label);
-            this->log->doneInferImage(
+            inferImage(
+                (*mnist)[imageIndex].get(), 
                 i, 
-                imageIndex, 
-                label, 
-                getAnswer());
+                &correctAnswersNumber, 
+                &costsSum);
+        }
+        endInfer(correctAnswersNumber, costsSum, imagesNumber);
+        this->log->doneCountAllocations(
+            getHeapAllocationsNumber()->load() - firstAllocationsNumber);
+    }
+    
+    // readImagesbatchMNISTɓǂݍ񂾉摜0ɂȂ܂Ő肷B
+    // ǂݍ񂾕𐄒肷邽тdoneInferBatcho͂B
+    // x̖摜͐RXg߂Ȃ̂ŁAdoneInfero͂ȂB
+    // 摜1ΉȂB
+    void inferStream(
+        MNIST                           *batchMNIST, 
+        const function<size_t(MNIST *)> &readImages, 
+        const bool                      &hasLabels) 
+    {
+        size_t correctAnswersNumber = 0;
+        double costsSum = 0.0;
+        size_t inferImageIndex = 0;
+        for (size_t n; (n = readImages(batchMNIST)) != 0;) {
+            for (auto i = 0; i < n; i++) 
+                inferImage(
+                    (*batchMNIST)[i].get(), 
+                    inferImageIndex++, 
+                    &correctAnswersNumber, 
+                    &costsSum);
+            this->log->doneInferBatch();
         }
-        costsSum += this->hyperParameters->regularization->computeWeightsCost(
+        if (hasLabels && inferImageIndex != 0) 
+            endInfer(correctAnswersNumber, costsSum, inferImageIndex);
+    }
+    
+    // imagesNumber̉摜܂Ƃ߂Đ肷Bscoresɂ͉摜Ƃɏo͑w̏oׂ͂B
+    void inferImages(
+        Image *const *images, 
+        const size_t &imagesNumber, 
+        size_t       *answers, 
+        double       *scores) 
+    {
+        this->inferencePlan.runBatch(images, imagesNumber, this->outputEpilogue.get(), answers, scores);
+    }
+    
+    // 摜̏o͑w̏o͂scoresɎʂA̍܂߂ȂRXgcostsSumɑB
+    size_t inferImage(Image *image, double *scores, double *costsSum) {
+        size_t answer = this->inferencePlan.run(image, this->outputEpilogue.get(), image->getLabel(), costsSum);
+        auto outputs = this->inferencePlan.getOutputs();
+        copy(outputs, outputs + LABEL_VALUES_NUMBER, scores);
+        return answer;
+    }
+    
+    double computeWeightsCost() {
+        return this->hyperParameters->regularization->computeWeightsCost(
             this->layers.get(), 
             this->hyperParameters->weightDecayRate);
-        this->log->doneInfer(
-            correctAnswersNumber, 
-            costsSum / (double)imagesNumber);
     }
     
+    // ȃp[^ƁAwriteSparseŏaȃp[^̂ǂǂށB
     void read(istream &is) {
-        for (auto l = this->layers->begin() + 1; l != this->layers->end(); l++) 
-            (*l)->read(is);
+        char magic[SPARSE_PARAMETERS_MAGIC_SIZE];
+        auto start = is.tellg();
+        is.read(magic, SPARSE_PARAMETERS_MAGIC_SIZE);
+        bool sparse = 
+            is.gcount() == SPARSE_PARAMETERS_MAGIC_SIZE && 
+            memcmp(magic, SPARSE_PARAMETERS_MAGIC, SPARSE_PARAMETERS_MAGIC_SIZE) == 0;
+        if (!sparse) {
+            is.clear();
+            is.seekg(start);
+        }
+        for (auto l = this->layers->begin() + 1; l != this->layers->end(); l++) {
+            if (sparse) 
+                (*l)->readSparse(is);
+            else 
+                (*l)->read(is);
+        }
+        this->inferencePlan.refresh();
     }
     
     void write(ostream &os) {
         for (auto l = this->layers->begin() + 1; l != this->layers->end(); l++) 
             (*l)->write(os);
     }
+    
+    // d݂ksi[(CSR)ŏB0̏d݂write菬B
+    void writeSparse(ostream &os) {
+        os.write(SPARSE_PARAMETERS_MAGIC, SPARSE_PARAMETERS_MAGIC_SIZE);
+        for (auto l = this->layers->begin() + 1; l != this->layers->end(); l++) 
+            (*l)->writeSparse(os);
+    }
 };
 
 class NetworkBuilder {
 protected:
     NetworkBuilder() = default;
     
-    using MakeLayerProc = function<shared_ptr<Layer>(vector<string> *)>;
+    using MakeLayerProc = function<shared_ptr<Layer>(vector<string> *, HyperParameters *)>;
     static map<string, MakeLayerProc> *getMakeLayerProcs() {
         static map<string, MakeLayerProc> MAKE_LAYER_PROCS = {
             {"input",          &makeInputLayer}, 
@@ -373,7 +1145,20 @@ protected:
         return &MAKE_LAYER_PROCS;
     }
     
-    static shared_ptr<Layer> makeInputLayer(vector<string> *args) {
+    // fastMathȂߎ֐ԂB
+    static ActivationFunction *getActivationFunction(
+        const string    &name, 
+        HyperParameters *hyperParameters) 
+    {
+        auto functions = hyperParameters->fastMath ? 
+            getFastActivationFunctions() : 
+            getActivationFunctions();
+        if (functions->count(name) == 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'", name, "'Ƃ֐͂܂B");
+        return functions->at(name).get();
+    }
+    
+    static shared_ptr<Layer> makeInputLayer(vector<string> *args, HyperParameters *hyperParameters) {
         auto conf = newInstance<map<string, string>>();
         (*conf)["dropoutRatio"] = DEFAULT_INPUT_DROPOUT_RATIO;
         setConfig(args->size() - 1, args->begin() + 1, conf.get());
@@ -383,11 +1168,12 @@ protected:
         return newInstance<InputLayer>(dropoutRatio);
     }
     
-    static shared_ptr<Layer> makeFullyConnectedHiddenLayer(vector<string> *args) {
+    static shared_ptr<Layer> makeFullyConnectedHiddenLayer(vector<string> *args, HyperParameters *hyperParameters) {
         auto conf = newInstance<map<string, string>>();
         (*conf)["neuronsNumber"]      = DEFAULT_FULLY_CONNECTED_NEURONS_NUMBER;
         (*conf)["dropoutRatio"]       = DEFAULT_FULLY_CONNECTED_DROPOUT_RATIO;
         (*conf)["activationFunction"] = DEFAULT_FULLY_CONNECTED_ACTIVATION_FUNCTION;
+        (*conf)["frozen"]             = DEFAULT_FULLY_CONNECTED_FROZEN;
         setConfig(args->size() - 1, args->begin() + 1, conf.get());
         size_t neuronsNumber = s2ul((*conf)["neuronsNumber"]);
         if (neuronsNumber == 0) 
@@ -395,28 +1181,29 @@ protected:
         double dropoutRatio = s2d((*conf)["dropoutRatio"]);
         if (dropoutRatio < 0.0 || dropoutRatio >= 1.0) 
             throw describe(__FILE__, "(", __LINE__, "): " , "hbvAEg0.0ȏォ1.0łȂ΂Ȃ܂B");
-        if (getActivationFunctions()->count((*conf)["activationFunction"]) == 0) 
-            throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["activationFunction"], "'Ƃ֐͂܂B");
+        if (YES_OR_NO.count((*conf)["frozen"]) == 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'frozen'yes܂nołȂ΂Ȃ܂B");
         return newInstance<FullyConnectedHiddenLayer>(
             neuronsNumber, 
             dropoutRatio, 
-            getActivationFunctions()->at((*conf)["activationFunction"]).get());
+            getActivationFunction((*conf)["activationFunction"], hyperParameters), 
+            YES_OR_NO.at((*conf)["frozen"]));
     }
     
-    static shared_ptr<Layer> makeOutputLayer(vector<string> *args) {
+    static shared_ptr<Layer> makeOutputLayer(vector<string> *args, HyperParameters *hyperParameters) {
         auto conf = newInstance<map<string, string>>();
         (*conf)["activationFunction"] = DEFAULT_OUTPUT_ACTIVATION_FUNCTION;
         setConfig(args->size() - 1, args->begin() + 1, conf.get());
-        if (getActivationFunctions()->count((*conf)["activationFunction"]) == 0) 
-            throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["activationFunction"], "'Ƃ֐͂܂B");
         return newInstance<OutputLayer>(
-            getActivationFunctions()->at((*conf)["activationFunction"]).get());
+            getActivationFunction((*conf)["activationFunction"], hyperParameters));
     }
 public:
+    // _ɎgȂmodeINFERENCE_MODEɂāAPɗvzmۂȂB
     shared_ptr<Network> build(
         istream               &is, 
         HyperParameters       *hyperParameters, 
-        const shared_ptr<Log> &log) 
+        const shared_ptr<Log> &log, 
+        const NetworkMode     &mode) 
     {
         auto layers = newInstance<vector<shared_ptr<Layer>>>();
         string line;
@@ -433,7 +1220,7 @@ public:
             string layerType = args[0];
             if (getMakeLayerProcs()->count(layerType) == 0) 
                 throw describe(__FILE__, "(", __LINE__, "): " , "'", layerType, "'Ƃw͂܂B");
-            layers->push_back(getMakeLayerProcs()->at(layerType)(&args));
+            layers->push_back(getMakeLayerProcs()->at(layerType)(&args, hyperParameters));
         }
         if (layers->size() < 1 || !dynamic_cast<InputLayer *>(layers->front().get())) 
             throw describe(__FILE__, "(", __LINE__, "): " , "ŏ̑w͓͑włȂ΂Ȃ܂B");
@@ -443,11 +1230,24 @@ public:
             if (!dynamic_cast<HiddenLayer *>(l->get())) 
                 throw describe(__FILE__, "(", __LINE__, "): " , "Ԃ̑w͉BwłȂ΂Ȃ܂B");
         }
+        for (auto l = layers->begin() + 2; l != layers->end(); l++) {
+            if ((*l)->isFrozen() && !(*(l - 1))->isFrozen()) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "w͓͑w̎瑱ĂȂ΂Ȃ܂B");
+        }
+        size_t arenaSize = 0;
+        for (auto i = 0; i < layers->size(); i++) 
+            arenaSize += (*layers)[i]->computeArenaSize(
+                i == 0 ? 0 : (*layers)[i - 1]->getNeuronsNumber(), 
+                mode);
+        arenaSize += InferencePlan::computeArenaSize(layers.get());
+        auto arena = newInstance<Arena>(arenaSize);
+        for (auto l : *layers) 
+            l->allocate(arena.get(), mode);
         for (auto i = 1; i < layers->size(); i++) 
             (*layers)[i]->connect(
                 (*layers)[i - 1].get(), 
                 hyperParameters->weightInitialization);
-        return newInstance<Network>(layers, hyperParameters, log);
+        return newInstance<Network>(arena, layers, mode, hyperParameters, log);
     }
     
     static NetworkBuilder *getInstance() {
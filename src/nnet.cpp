@@ -1,24 +1,74 @@
+#include "allreduce.h"
+#include "arena.h"
 #include "costfunc.h"
+#include "ensemble.h"
 #include "help.h"
+#include "imgstream.h"
 #include "layer.h"
+#include "logsink.h"
+#include "lowrank.h"
 #include "mnist.h"
 #include "network.h"
+#include "perf.h"
 #include "regriz.h"
+#include "server.h"
+#include "sweep.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <sstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
+void *operator new(size_t size) {
+    getHeapAllocationsNumber()->fetch_add(1, memory_order_relaxed);
+    void *p = malloc(size == 0 ? 1 : size);
+    if (!p) 
+        throw bad_alloc();
+    return p;
+}
+
+// unewdeletemallocfreeő΂ɂȂĂ邪AGCC̓CCWJfreesvƌx̂ŗ}B
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
 #define DEFAULT_NETWORK_FILE          "default.network"
 #define DEFAULT_WEIGHT_INITIALIZATION "broad"
 #define DEFAULT_PARAMETERS_FILE       "default.parameters"
 #define DEFAULT_COST_FUNCTION         "quadratic"
 #define DEFAULT_REGULARIZATION        "null"
 #define DEFAULT_WEIGHT_DECAY_RATE     "0.1"
+#define DEFAULT_SEED                  ""
+#define DEFAULT_THREADS               "0"
+#define DEFAULT_NUMA                  "auto"
+#define DEFAULT_HUGE_PAGES            "transparent"
+#define DEFAULT_PERF_COUNTERS         "no"
+#define DEFAULT_TRACE_FILE            ""
+#define DEFAULT_FAST_MATH             "no"
+#define DEFAULT_COUNT_ALLOCATIONS     "no"
+#define DEFAULT_LOG_FORMAT            "text"
 #define DEFAULT_TRAIN_IMAGES_FILE     "data/train.images"
 #define DEFAULT_TRAIN_LABELS_FILE     "data/train.labels"
 #define DEFAULT_EVAL_IMAGES_FILE      "data/infer.images"
@@ -27,14 +77,48 @@ using namespace std;
 #define DEFAULT_TRAIN_IMAGES_NUMBER   "1000"
 #define DEFAULT_EVAL_IMAGES_OFFSET    "0"
 #define DEFAULT_EVAL_IMAGES_NUMBER    "100"
+#define DEFAULT_EVAL_EVERY            "1"
+#define DEFAULT_EVAL_SUBSAMPLE        "0"
 #define DEFAULT_READ_PARAMETERS       "yes"
+#define DEFAULT_CACHE_FROZEN          "no"
+#define DEFAULT_INPUT_DROPOUT         ""
+#define DEFAULT_HIDDEN_DROPOUT        ""
 #define DEFAULT_EPOCHS_NUMBER         "10"
 #define DEFAULT_BATCH_SIZE            "10"
 #define DEFAULT_LEARNING_RATE         "5.0"
+#define DEFAULT_WORKERS               "1"
+#define DEFAULT_ALLREDUCE             "shm"
 #define DEFAULT_INFER_IMAGES_FILE     "data/infer.images"
 #define DEFAULT_INFER_LABELS_FILE     "data/infer.labels"
 #define DEFAULT_INFER_IMAGES_OFFSET   "0"
 #define DEFAULT_INFER_IMAGES_NUMBER   "100"
+#define DEFAULT_INFER_SCORES          "no"
+#define DEFAULT_INFER_TOP_NUMBER      "3"
+#define DEFAULT_ENSEMBLE_FILE         ""
+#define DEFAULT_ENSEMBLE_COMBINE      "mean"
+#define DEFAULT_SWEEP_FILE            "sweep.spec"
+#define DEFAULT_SWEEP_MODE            "grid"
+#define DEFAULT_SWEEP_TRIALS_NUMBER   "10"
+#define DEFAULT_SWEEP_CONCURRENCY     "0"
+#define DEFAULT_SWEEP_PRUNE_AFTER     "2"
+#define DEFAULT_SWEEP_RESULT_FILE     "sweep.result"
+#define DEFAULT_STREAM_LABELS         "no"
+#define DEFAULT_STREAM_BATCH_SIZE     "100"
+#define DEFAULT_SOCKET_FILE           "nnet.sock"
+#define DEFAULT_MAX_BATCH_SIZE        "32"
+#define DEFAULT_MAX_BATCH_WAIT        "0"
+#define DEFAULT_REPORT_INTERVAL       "10"
+#define DEFAULT_SERVE_REQUESTS_NUMBER "0"
+#define DEFAULT_PRUNE_SPARSITY        "0.9"
+#define DEFAULT_PRUNE_EPOCHS_NUMBER   "0"
+#define DEFAULT_PRUNED_FILE           "pruned.parameters"
+#define DEFAULT_COMPRESS_ENERGY       "0.9"
+#define DEFAULT_COMPRESS_MAX_LOSS     ""
+#define DEFAULT_COMPRESS_OUTPUT       "compressed"
+#define DEFAULT_TUNE_BATCH_SIZES      "1,5,10,20,50,100"
+#define DEFAULT_TUNE_THREADS          ""
+#define DEFAULT_TUNE_REPEATS          "3"
+#define DEFAULT_TUNE_RESULT_FILE      "tune.result"
 
 const string USAGE = 
 "nnet̓j[lbg[NA菑摜ɂPƐs܂B\n"
@@ -50,7 +134,13 @@ const string USAGE =
 "߂̈ꗗ\n"
 "  train lbg[NP\n"
 "  infer 摜̃x𐄒肷\n"
-"train߂infer߂ɋʂ̐ݒ荀ڂ̈ꗗ\n"
+"  stream W͂͂摜̃x𐄒肷\n"
+"  serve 풓ă\Pbg͂摜̃x𐄒肷\n"
+"  sweep ݒςȂ畡̌PsĎ\n"
+"  prune ȏd݂0ɂāAaȃp[^o\n"
+"  compress Bw̏d݂K̒Ⴂ2̑wɕAlbg[Nƃp[^o\n"
+"  tune 𑪂āAbatchSizeAthreadsfastMath̍łݒo\n"
+"SĂ̖߂ɋʂ̐ݒ荀ڂ̈ꗗ\n"
 "  networkFile          lbg[N`t@CB\n"
 "                       ȗȂ" DEFAULT_NETWORK_FILE "B\n"
 "                       ݂Ȃ΃ftHg̃lbg[Ng܂B\n"
@@ -60,6 +150,39 @@ const string USAGE =
 "  costFunction         RXg֐BȗȂ" DEFAULT_COST_FUNCTION "\n"
 "  regularization       BȗȂ" DEFAULT_REGULARIZATION "\n"
 "  weightDecayRate      dݕ␳BȗȂ" DEFAULT_WEIGHT_DECAY_RATE "\n"
+"  fastMath             ֐exptanhߎŋ߂邩ǂByes܂noB\n"
+"                       Ό덷͍őŃVOCh֐7.1e-9A\tg}bNX֐1.5e-8łB\n"
+"                       ȗȂ" DEFAULT_FAST_MATH "\n"
+"  seed                 ̎BB\n"
+"                       ȗȂ猻ݎ猈߂܂B\n"
+"  threads              vZɎgXbh̐B0Ȃn[hEFÃXbhB\n"
+"                       PA]AAT1̃Xbhv[L܂B\n"
+"                       workers2ȏȂAXbhvZXɓ܂B\n"
+"                       ȗȂ" DEFAULT_THREADS "\n"
+"  numa                 NUMÃm[h2ȏ゠ƂɁAm[hӎēǂB\n"
+"                       auto܂offBautoȂXbhCPUɌŒ肵A\n"
+"                       ł͏d݂m[hƂɎʂ܂BȗȂ" DEFAULT_NUMA "\n"
+"  hugePages            2MBȏ̃p[^AzAf[^Zbg̗̈傫ȃy[WɒuǂB\n"
+"                       noAtransparent܂hugetlbBtransparentȂmadviseŗ݁A\n"
+"                       hugetlbȂ\񂳂ꂽ傫ȃy[W܂BȂtransparent\n"
+"                       ɂ܂BȗȂ" DEFAULT_HUGE_PAGES "\n"
+"  countAllocations     ŏ̃ob`̌̃q[vmۂ̉񐔂Oɏo͂邩ǂB\n"
+"                       yes܂noBȗȂ" DEFAULT_COUNT_ALLOCATIONS "\n"
+"  perfCounters         P̐ゲƂɁAiKƂ̃n[hEFÃJE^Oɏo͂邩ǂB\n"
+"                       yes܂noBperf_event_openŌP񂷃Xbh̃[U[Ԃ𐔂܂B\n"
+"                       JE^1JȂΉo͂AJȂJE^0Ƃ܂B\n"
+"                       PMUdƂ͐ĂԂ̊ŕ₢A\n"
+"                       xȂiK͏o͂܂B\n"
+"                       ȗȂ" DEFAULT_PERF_COUNTERS "\n"
+"  traceFile            ChromePerfettoŊJJSOÑg[Xt@C̖OB\n"
+"                       Aob`AwƂ̏`dƋt`dA]Ap[^̕ۑA\n"
+"                       Xbhv[̎d̋ԂAXbhƂɃOobt@ɋL^A\n"
+"                       ߂̏Iɏ܂BXbhƂɍŐV65536̋Ԃc܂B\n"
+"                       workersŌPȂA0łȂvZX͖Ǒ.ʂt\n"
+"                       t@Cɏ܂BȗȂg[X܂B\n"
+"  logFormat            Ǒ`Btext܂binaryBȗȂ" DEFAULT_LOG_FORMAT "\n"
+"                       text̓^u؂̍sAbinary͏ȃoCi̋L^łB\n"
+"                       ǂ܂Ƃ߂ďoAinfview͂ǂǂ߂܂B\n"
 "train߂̐ݒ荀ڂ̈ꗗ\n"
 "  trainImagesFile   PɎg菑摜̃t@CB\n"
 "                    ȗȂ" DEFAULT_TRAIN_IMAGES_FILE "\n"
@@ -73,10 +196,33 @@ const string USAGE =
 "                    ȗȂ" DEFAULT_EVAL_LABELS_FILE "\n"
 "  evalImagesOffset  ]Ɏg摜̃ItZbgBȗȂ" DEFAULT_EVAL_IMAGES_OFFSET "\n"
 "  evalImagesNumber  ]Ɏg摜̐BȗȂ" DEFAULT_EVAL_IMAGES_NUMBER "\n"
+"  evalEvery         ]鐢̊ԊuBŌ͕̐K]܂BȗȂ" DEFAULT_EVAL_EVERY "\n"
+"  evalSubsample     1̕]Ɏg摜̐B]Ɏg摜瓙ԊuɑIсA\n"
+"                    ]̂тɑIԈʒu炵܂B0ȂSĎg܂B\n"
+"                    ȗȂ" DEFAULT_EVAL_SUBSAMPLE "\n"
+"                    ]͐̏Ȉd݂̎ʂŁA̐̌Pƕsčs܂B\n"
 "  readParameters    p[^ǂݍނǂByes܂noBȗȂ" DEFAULT_READ_PARAMETERS "\n"
+"  cacheFrozen       wƂAP̎n߂ɉ摜ƂɓŌ̑w̏o͂\n"
+"                    ߂ĂAゲƂɂ͓ĂȂw߂邩ǂByes܂noB\n"
+"                    ͑wƓw̃hbvAEg0łȂ΂Ȃ܂B\n"
+"                    P̉摜̐ƓŌ̑w̃j[̐̐ςdoublemۂ܂B\n"
+"                    sweep߂ł͎g܂BȗȂ" DEFAULT_CACHE_FROZEN "\n"
 "  epochsNumber      ̐BȗȂ" DEFAULT_EPOCHS_NUMBER "\n"
 "  batchSize         ob`̑傫BȗȂ" DEFAULT_BATCH_SIZE "\n"
 "  learningRate      wKBȗȂ" DEFAULT_LEARNING_RATE "\n"
+"  inputDropout      ͑w̃hbvAEgBlbg[N̒`D悵܂B\n"
+"                    ȗȂlbg[N̒`̂Ƃ\n"
+"  hiddenDropout     SĂ̑Sڑw̃hbvAEgBlbg[N̒`D悵܂B\n"
+"                    ȗȂlbg[N̒`̂Ƃ\n"
+"  workers           PvZX̐B2ȏȂqvZXAPɎg摜\n"
+"                    vZXɓ܂BtrainImagesNumberworkersŊ؂Ȃ΂Ȃ܂B\n"
+"                    ob`ƂɑSẴvZX̌z̕ςōXV̂ŁA\n"
+"                    ob`̑傫batchSizeworkers{ƓłB\n"
+"                    Oƃp[^͍ŏ̃vZXoA]̃vZXs܂B\n"
+"                    threads̓vZXƂ̃XbhłBsweep߂ł͎g܂B\n"
+"                    ȗȂ" DEFAULT_WORKERS "\n"
+"  allreduce         workers2ȏ̂ƂɌzʐMHB\n"
+"                    shmȂ狤LAtcpȂ烋[vobNTCPBȗȂ" DEFAULT_ALLREDUCE "\n"
 "infer߂̐ݒ荀ڂ̈ꗗ\n"
 "  inferImagesFile   Ɏg菑摜̃t@CB\n"
 "                    ȗȂ" DEFAULT_INFER_IMAGES_FILE "\n"
@@ -84,6 +230,100 @@ const string USAGE =
 "                    ȗȂ" DEFAULT_INFER_LABELS_FILE "\n"
 "  inferImagesOffset Ɏg摜̃ItZbgBȗȂ" DEFAULT_INFER_IMAGES_OFFSET "\n"
 "  inferImagesNumber Ɏg摜̐BȗȂ" DEFAULT_INFER_IMAGES_NUMBER "\n"
+"  inferScores       摜Ƃɏo͑w̏o͂doneInferScoresɏo͂邩ǂB\n"
+"                    noAall(x̏ɑS)Atop(傫inferTopNumber)̂ꂩB\n"
+"                    stream߂łg܂BȗȂ" DEFAULT_INFER_SCORES "\n"
+"  inferTopNumber    inferScorestop̂Ƃɏo͂鐔BȗȂ" DEFAULT_INFER_TOP_NUMBER "\n"
+"  ensembleFile      ATu̒`̃t@CBw肷networkFileparametersFilȇɎgA\n"
+"                    摜ƂɑSẴfŐ肵ďo͂gݍ킹܂B\n"
+"                    sƂ'lbg[Ñt@C p[^̃t@C'܂B\n"
+"                    󔒍s'#'Ŏn܂s͖܂BȗȂATuɂ܂\n"
+"  ensembleCombine   o͂̑gݍ킹BmeanȂo͂̕ρAvoteȂef̓̓[B\n"
+"                    voteœ[񂾂o͂̕ς̑傫𓚂ɂ܂B\n"
+"                    doneInferImagedoneInferScores̓ATu̓ƏóA\n"
+"                    doneInfer̃RXg̓f̃RXg̕ςłBȗȂ" DEFAULT_ENSEMBLE_COMBINE "\n"
+"stream߂̐ݒ荀ڂ̈ꗗ\n"
+"  streamLabels    R[hx܂ނǂByes܂noBȗȂ" DEFAULT_STREAM_LABELS "\n"
+"  streamBatchSize ܂Ƃ߂Đ肷郌R[h̍ő吔BȗȂ" DEFAULT_STREAM_BATCH_SIZE "\n"
+"  W͂ɂ784oCg̉摜(28x28̋Px)̃R[h𑱂ď܂B\n"
+"  streamLabelsyesȂAeR[h̐擪1oCg̃xt܂B\n"
+"  ͂R[h̓ob`܂邩͂r؂ꂽ琄肵AɃOo͂܂B\n"
+"  xdoneInferImagedoneInferAdoneStreamImageo͂܂B\n"
+"  R[hΉo͂ɏI܂B\n"
+"sweep߂̐ݒ荀ڂ̈ꗗ\n"
+"  train߂̐ݒ荀ڂg܂BsƂsweepFile̒lŒu܂B\n"
+"  sweepFile         T͈̔͂̃t@CBȗȂ" DEFAULT_SWEEP_FILE "\n"
+"                    sƂ'ݒ荀ږ l...'܂B󔒍s'#'Ŏn܂s͖܂B\n"
+"                    Ⴆ'learningRate 0.5 1.0 3.0'̂悤ɏ܂B\n"
+"                    Tłݒ荀ڂnetworkFileAlearningRateAbatchSizeA\n"
+"                    weightDecayRateAregularizationAcostFunctionA\n"
+"                    inputDropoutAhiddenDropoutAepochsNumberłB\n"
+"  sweepMode         gridȂSĂ̑gݍ킹ArandomȂ獀ڂƂɒl𖳍ׂɑI񂾑g܂B\n"
+"                    ȗȂ" DEFAULT_SWEEP_MODE "\n"
+"  sweepTrialsNumber sweepModerandom̂Ƃ̎s̐BȗȂ" DEFAULT_SWEEP_TRIALS_NUMBER "\n"
+"  sweepConcurrency  sčss̐B0Ȃthreads̃XbhB\n"
+"                    threads葽ĂAɍssthreads܂łłB\n"
+"                    Xbh͎sɓ܂BȗȂ" DEFAULT_SWEEP_CONCURRENCY "\n"
+"  sweepPruneAfter   ̐̐ォA]̐𐔂I\n"
+"                    ̎s̒l鎎sł؂܂B0Ȃł؂܂B\n"
+"                    ȗȂ" DEFAULT_SWEEP_PRUNE_AFTER "\n"
+"  sweepResultFile   ʂ̃t@CBsƂ̌ʂ'#'Ŏn܂sɁA\n"
+"                    łǂs̐ݒ'<ږ>=<e>'̍sɏ܂B\n"
+"                    '@<t@C>'ł̂܂ܓǂݍ߂܂BȗȂ" DEFAULT_SWEEP_RESULT_FILE "\n"
+"  Pƕ]̉摜͈xǂݍőSĂ̎sŋL܂Bp[^͏o܂B\n"
+"serve߂̐ݒ荀ڂ̈ꗗ\n"
+"  socketFile          ҂󂯂UnixhC\Pbg̃t@CB\n"
+"                      ȗȂ" DEFAULT_SOCKET_FILE "\n"
+"  maxBatchSize        ܂Ƃ߂Đ肷v̍ő吔B肵ĂԂɓ͂v\n"
+"                      ̐܂ł܂Ƃ߂1xɐ肵܂BȗȂ" DEFAULT_MAX_BATCH_SIZE "\n"
+"  maxBatchWait        ŏ̗v͂Ă玟̗v҂ő̎(}CNb)B\n"
+"                      0Ȃ҂ɁA͂Ăv܂Ƃ߂܂B\n"
+"                      ȗȂ" DEFAULT_MAX_BATCH_WAIT "\n"
+"  reportInterval      doneServeIntervalo͂Ԋu(b)B0Ȃo͂܂B\n"
+"                      ȗȂ" DEFAULT_REPORT_INTERVAL "\n"
+"  serveRequestsNumber ̗̐vɓI܂B0ȂI܂B\n"
+"                      ȗȂ" DEFAULT_SERVE_REQUESTS_NUMBER "\n"
+"  v784oCg̉摜(28x28̋Px)łB\n"
+"  1oCg̓ƁAo͑w̏oׂ͂double(10)łB\n"
+"  1̐ڑőėv𑗂邱Ƃł܂BSIGINTSIGTERMŏI܂B\n"
+"prune߂̐ݒ荀ڂ̈ꗗ\n"
+"  pruneSparsity     wƂ0ɂd݂̊B0ȏ1BΒl̏d݂0ɂ܂B\n"
+"                    ȗȂ" DEFAULT_PRUNE_SPARSITY "\n"
+"  pruneEpochsNumber 0ɂɌP鐢̐B0ɂd݂0̂܂܌P܂B\n"
+"                    train߂̐ݒ荀ڂŌP܂BȗȂ" DEFAULT_PRUNE_EPOCHS_NUMBER "\n"
+"  prunedFile        aȃp[^ot@CBparametersFileƂĂǂ̖߂łǂ߂܂B\n"
+"                    ȗȂ" DEFAULT_PRUNED_FILE "\n"
+"  parametersFilẽp[^ǂݍ0ɂAwƂdonePruneo͂܂B\n"
+"  ł́A0łȂd݂̊0.3ȉ̑w0̏d݂΂ċ߂܂B\n"
+"compress߂̐ݒ荀ڂ̈ꗗ\n"
+"  compressEnergy  wƂɎcAْl2̘åB0傫1ȉB\n"
+"                  ̊ȏcŏ̊KIт܂BȗȂ" DEFAULT_COMPRESS_ENERGY "\n"
+"  compressMaxLoss ]̐𗦂̒ቺB0ȏ1Bw肷compressEnergy̑ɁA\n"
+"                  Ȏw珇ɁA]̐𗦂̒ቺȉɂȂŏ̊K񕪒T܂B\n"
+"                  ȗȂwȂ\n"
+"  compressOutput  ot@C̖OB'<compressOutput>.network'Ƀlbg[NA\n"
+"                  '<compressOutput>.parameters'Ƀp[^o܂B\n"
+"                  networkFileparametersFileƂĂǂ̖߂łg܂B\n"
+"                  ȗȂ" DEFAULT_COMPRESS_OUTPUT "\n"
+"  parametersFilẽp[^ǂݍ݁ABw̏dْ݂lāAKrank̋ߎɒu܂B\n"
+"  uw̑Oɂ́Arank̃j[̐`̑Sڑw݂܂B\n"
+"  2̑wɂĂϘaȂw͂̂܂܂ɂ܂B\n"
+"  wƂdoneCompressLayero͂AŌɕ]̉摜doneCompresso͂܂B\n"
+"tune߂̐ݒ荀ڂ̈ꗗ\n"
+"  train߂̐ݒ荀ڂ̂AnetworkFileAparametersFileAlearningRateA\n"
+"  trainImagesOffsettrainImagesNumberg܂B\n"
+"  tuneBatchSizes P̑𑪂batchSize̕сB','ŋ؂܂B\n"
+"                 ȗȂ" DEFAULT_TUNE_BATCH_SIZES "\n"
+"  tuneThreads    PƐ̑𑪂Xbh̐̕сB','ŋ؂܂Bthreads̃XbhȉB\n"
+"                 ȗȂ1{Xthreads̃Xbh܂\n"
+"  tuneRepeats    gƂɑ񐔁BlŔׂ܂BȗȂ" DEFAULT_TUNE_REPEATS "\n"
+"  tuneResultFile ʂ̃t@CBgƂ̑'#'Ŏn܂sɁA\n"
+"                 łݒ'<ږ>=<e>'̍sɏ܂B\n"
+"                 '@<t@C>'ł̂܂ܓǂݍ߂܂BȗȂ" DEFAULT_TUNE_RESULT_FILE "\n"
+"  fastMathyesnoꂼŁAbatchSizeƂɌP̉摜1ゾPđ𑪂܂B\n"
+"  łbatchSizefastMathŁAXbh̐ƂɌPƐ̑𑪂܂B\n"
+"  threads͌P̑őIт܂B̑͌ʂ̃t@CɏłB\n"
+"  parametersFile݂Γǂݍ݂܂Bp[^͏o܂B\n"
 "lbg[N̒`\n"
 "  sƂɑw`܂B'w̎ ݒ...'łB\n"
 "  Ⴆ'fullyConnected neuronsNumber=30'̂悤ɏ܂B\n"
@@ -99,19 +339,29 @@ const string USAGE =
 "      neuronsNumber      j[̐BȗȂ" DEFAULT_FULLY_CONNECTED_NEURONS_NUMBER "\n"
 "      dropoutRatio       hbvAEgB>= 0.0 && < 1.0BȗȂ" DEFAULT_FULLY_CONNECTED_DROPOUT_RATIO "\n"
 "      activationFunction ֐BȗȂ" DEFAULT_FULLY_CONNECTED_ACTIVATION_FUNCTION "\n"
+"      frozen             yesȂPł̑w̃p[^XVA덷t`d܂B\n"
+"                         w͓͑w̎瑱ĂȂ΂Ȃ܂B\n"
+"                         yes܂noBȗȂ" DEFAULT_FULLY_CONNECTED_FROZEN "\n"
 "  output         o͑w\n"
 "    ݒ荀ڂ̈ꗗ\n"
 "      activationFunction ֐BȗȂ" DEFAULT_OUTPUT_ACTIVATION_FUNCTION "\n"
 "֐̈ꗗ\n"
-"  sigmoid VOCh֐\n"
-"  tanh    nCp{bN^WFg֐\n"
-"  softmax \tg}bNX֐\n"
+"  sigmoid   VOCh֐\n"
+"  tanh      nCp{bN^WFg֐\n"
+"  softmax   \tg}bNX֐\n"
+"  relu      v֐\n"
+"  leakyRelu ̑̌X0.01̃v֐\n"
+"  elu       ̑exp(x) - 1̎w`֐\n"
+"  linear    ͂̂܂܏o͂P֐\n"
+"  reluleakyRelueluweightInitializationheɂƁA\n"
+"  wd˂Ăo͂̑傫܂B\n"
 "ftHg̃lbg[N: ͑wƏo͑w܂B\n"
 "  input\n"
 "  output\n"
 "d݂̏̈ꗗ\n"
 "  broad  LU\n"
 "  narrow U\n"
+"  he     ͂̐Ō߂He̕UBReLUn̊֐\n"
 "RXg֐̈ꗗ\n"
 "  quadratic    ϓ덷֐\n"
 "  crossEntropy NXGgs[֐\n"
@@ -120,7 +370,10 @@ const string USAGE =
 "  l1   L1\n"
 "  l2   L2\n"
 "Wo: Oo͂܂B\n"
-"  sƂ̏'O̎ f[^...'łB^uŋ؂܂B\n"
+"  logFormattextȂAsƂ̏'O̎ f[^...'łB^uŋ؂܂B\n"
+"  binaryȂA擪8oCg̎ʎq'NNETLOG\\x01'ɑāAL^Ƃ\n"
+"  1oCg̃O̎(ꗗ̏0)ƃf[^܂B\n"
+"  ͉ʂ7rbg̉ϒA8oCgdoublełB\n"
 "O̎ނ̈ꗗ\n"
 "  doneTrainEpoch ̌P\n"
 "    f[^̈ꗗ\n"
@@ -129,6 +382,8 @@ const string USAGE =
 "      P̃RXg\n"
 "      ]̐\n"
 "      ]̃RXg\n"
+"    ]Ȃł͕]̐𐔂ƃRXg0łB\n"
+"    ]鐢̃ÓA̐̌Pƕs]IĂo͂܂B\n"
 "  doneTrain      P\n"
 "    f[^̈ꗗ\n"
 "      P̑\n"
@@ -145,6 +400,91 @@ const string USAGE =
 "    f[^̈ꗗ\n"
 "      \n"
 "      RXg\n"
+"  doneStreamImage x̖摜̐\n"
+"    f[^̈ꗗ\n"
+"      摜̔ԍ\n"
+"      lbg[N肵\n"
+"  doneServeInterval reportIntervalƂ̗vւ̉̓v\n"
+"    f[^̈ꗗ\n"
+"      v̐\n"
+"      X[vbg(v/b)\n"
+"      x50p[Z^C(}CNb)\n"
+"      x90p[Z^C(}CNb)\n"
+"      x99p[Z^C(}CNb)\n"
+"      ob`̕ς̑傫\n"
+"  doneServe      serve߂Bf[^doneServeIntervalƓŁAŜ̓vłB\n"
+"  doneCountAllocations q[vmۂ̉񐔂𐔂I\n"
+"    countAllocationsyeŝƂo͂܂B\n"
+"    f[^̈ꗗ\n"
+"      ŏ̃ob`(ł͍ŏ̉摜)̌̃q[vmۂ̉\n"
+"  doneInferScores 摜̏o͑w̏o\n"
+"    inferScoresnołȂ΁AdoneInferImage܂doneStreamImagěɏo͂܂B\n"
+"    f[^̈ꗗ\n"
+"      摜̐̔ԍ\n"
+"      摜̔ԍ\n"
+"      g̐\n"
+"      xƏo͂̑g̕\n"
+"  doneSweepEpoch s̐̌P\n"
+"    f[^̈ꗗ\n"
+"      s̔ԍ\n"
+"      ̔ԍ\n"
+"      P̐\n"
+"      P̃RXg\n"
+"      ]̐\n"
+"      ]̃RXg\n"
+"  doneSweepTrial s\n"
+"    f[^̈ꗗ\n"
+"      s̔ԍ\n"
+"      P̐\n"
+"      Ō̕]̐\n"
+"      Ō̕]̃RXg\n"
+"      ł؂Ȃ1AłȂ0\n"
+"  doneInferModel ATũf̐\n"
+"    ensembleFilew肵ƂAdoneInfeȓOɃfƂɏo͂܂B\n"
+"    f[^̈ꗗ\n"
+"      f̔ԍ(ensembleFile̍s̏0)\n"
+"      \n"
+"      RXg\n"
+"  donePrune      w̏d݂0ɂI\n"
+"    f[^̈ꗗ\n"
+"      w̔ԍ(͑w0Ƃ)\n"
+"      d݂̐\n"
+"      0łȂd݂̐\n"
+"  doneCompressLayer w̏d݂𕪂I\n"
+"    f[^̈ꗗ\n"
+"      w̔ԍ(͑w0ƂāAcompressOutput̃lbg[NłȂ̃lbg[N̔ԍ)\n"
+"      d݂̐\n"
+"      2̑w̏d݂̐BȂw͏d݂̐Ɠ\n"
+"      KBȂwْ͓l̐\n"
+"      cْl2̘å\n"
+"  doneCompress   compress߂\n"
+"    f[^̈ꗗ\n"
+"      ̃lbg[N̕]̐\n"
+"      ̃lbg[N̕]̃RXg\n"
+"      olbg[N̕]̐\n"
+"      olbg[N̕]̃RXg\n"
+"  doneTuneTrain  tune߂ŌP̑𑪂I\n"
+"    f[^̈ꗗ\n"
+"      batchSize\n"
+"      Xbh̐\n"
+"      fastMathyesȂ1AłȂ0\n"
+"      1bɌP摜̐̒l\n"
+"  doneTuneInfer  tune߂Ő̑𑪂I\n"
+"    f[^̈ꗗ\n"
+"      Xbh̐\n"
+"      fastMathyesȂ1AłȂ0\n"
+"      1bɐ肵摜̐̒l\n"
+"  donePerfPhase  ̒iK̃n[hEFÃJE^𐔂I\n"
+"    perfCountersyesŃJE^JƂAdoneTrainEpoch̑OɒiKƂɏo͂܂B\n"
+"    JE^̑gxȂiK͏o͂܂B\n"
+"    f[^̈ꗗ\n"
+"      ̔ԍ\n"
+"      iKB0͏`dA1͋t`dA2̓p[^̍XVA3͕]A4͉摜̑I\n"
+"      TCN\n"
+"      ߐ\n"
+"      L1f[^LbV̓ǂݍ݂̃~X\n"
+"      ŏIxLbV̓ǂݍ݂̃~X\n"
+"      f[^TLB̓ǂݍ݂̃~X\n"
 ;
 
 const string DEFAULT_NETWORK = 
@@ -154,16 +494,54 @@ const string DEFAULT_NETWORK =
 
 void train(map<string, string> *conf, HyperParameters *hyperParameters);
 void infer(map<string, string> *conf, HyperParameters *hyperParameters);
+void stream(map<string, string> *conf, HyperParameters *hyperParameters);
+void serve(map<string, string> *conf, HyperParameters *hyperParameters);
+void sweep(map<string, string> *conf, HyperParameters *hyperParameters);
+void prune(map<string, string> *conf, HyperParameters *hyperParameters);
+void compress(map<string, string> *conf, HyperParameters *hyperParameters);
+void tune(map<string, string> *conf, HyperParameters *hyperParameters);
 
 using CommandProc = function<void(map<string, string> *, HyperParameters *)>;
 inline const map<string, CommandProc> *getCommandProcs() {
     static const map<string, CommandProc> COMMAND_PROCS = {
-        {"train", &train}, 
-        {"infer", &infer}, 
+        {"train",    &train}, 
+        {"infer",    &infer}, 
+        {"stream",   &stream}, 
+        {"serve",    &serve}, 
+        {"sweep",    &sweep}, 
+        {"prune",    &prune}, 
+        {"compress", &compress}, 
+        {"tune",     &tune}, 
     };
     return &COMMAND_PROCS;
 }
 
+void setHyperParameters(map<string, string> *conf, HyperParameters *hyperParameters) {
+    if (getWeightInitializations()->count((*conf)["weightInitialization"]) == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["weightInitialization"], "'Ƃdݏ͂܂B");
+    if (getCostFunctions()->count((*conf)["costFunction"]) == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["costFunction"], "'ƂRXg֐͂܂B");
+    if (getRegularizations()->count((*conf)["regularization"]) == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["regularization"], "'Ƃ͂܂B");
+    if (YES_OR_NO.count((*conf)["fastMath"]) == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'fastMath'yes܂nołȂ΂Ȃ܂B");
+    hyperParameters->weightInitialization = getWeightInitializations()->at((*conf)["weightInitialization"]).get();
+    hyperParameters->costFunction         = getCostFunctions()->at((*conf)["costFunction"]).get();
+    hyperParameters->regularization       = getRegularizations()->at((*conf)["regularization"]).get();
+    hyperParameters->weightDecayRate      = s2d((*conf)["weightDecayRate"]);
+    hyperParameters->fastMath             = YES_OR_NO.at((*conf)["fastMath"]);
+}
+
+// fork0łȂvZX́AtraceFilěɏʂtt@CɏB
+void writeTrace(map<string, string> *conf) {
+    size_t processIndex = Tracer::getInstance()->getProcessIndex();
+    Tracer::getInstance()->write(*openFile<ofstream>(
+        processIndex == 0 ? 
+            (*conf)["traceFile"] : 
+            (*conf)["traceFile"] + "." + to_string(processIndex), 
+        ios::out | ios::trunc));
+}
+
 int main(int argc, char **argv) {
     int result = 0;
     try {
@@ -181,6 +559,15 @@ int main(int argc, char **argv) {
         (*conf)["costFunction"]         = DEFAULT_COST_FUNCTION;
         (*conf)["regularization"]       = DEFAULT_REGULARIZATION;
         (*conf)["weightDecayRate"]      = DEFAULT_WEIGHT_DECAY_RATE;
+        (*conf)["fastMath"]             = DEFAULT_FAST_MATH;
+        (*conf)["seed"]                 = DEFAULT_SEED;
+        (*conf)["threads"]              = DEFAULT_THREADS;
+        (*conf)["numa"]                 = DEFAULT_NUMA;
+        (*conf)["hugePages"]            = DEFAULT_HUGE_PAGES;
+        (*conf)["perfCounters"]         = DEFAULT_PERF_COUNTERS;
+        (*conf)["traceFile"]            = DEFAULT_TRACE_FILE;
+        (*conf)["countAllocations"]     = DEFAULT_COUNT_ALLOCATIONS;
+        (*conf)["logFormat"]            = DEFAULT_LOG_FORMAT;
         (*conf)["trainImagesFile"]      = DEFAULT_TRAIN_IMAGES_FILE;
         (*conf)["trainLabelsFile"]      = DEFAULT_TRAIN_LABELS_FILE;
         (*conf)["trainImagesOffset"]    = DEFAULT_TRAIN_IMAGES_OFFSET;
@@ -189,29 +576,79 @@ int main(int argc, char **argv) {
         (*conf)["evalLabelsFile"]       = DEFAULT_EVAL_LABELS_FILE;
         (*conf)["evalImagesOffset"]     = DEFAULT_EVAL_IMAGES_OFFSET;
         (*conf)["evalImagesNumber"]     = DEFAULT_EVAL_IMAGES_NUMBER;
+        (*conf)["evalEvery"]            = DEFAULT_EVAL_EVERY;
+        (*conf)["evalSubsample"]        = DEFAULT_EVAL_SUBSAMPLE;
         (*conf)["readParameters"]       = DEFAULT_READ_PARAMETERS;
+        (*conf)["cacheFrozen"]          = DEFAULT_CACHE_FROZEN;
+        (*conf)["inputDropout"]         = DEFAULT_INPUT_DROPOUT;
+        (*conf)["hiddenDropout"]        = DEFAULT_HIDDEN_DROPOUT;
         (*conf)["epochsNumber"]         = DEFAULT_EPOCHS_NUMBER;
         (*conf)["batchSize"]            = DEFAULT_BATCH_SIZE;
         (*conf)["learningRate"]         = DEFAULT_LEARNING_RATE;
+        (*conf)["workers"]              = DEFAULT_WORKERS;
+        (*conf)["allreduce"]            = DEFAULT_ALLREDUCE;
         (*conf)["inferImagesFile"]      = DEFAULT_INFER_IMAGES_FILE;
         (*conf)["inferLabelsFile"]      = DEFAULT_INFER_LABELS_FILE;
         (*conf)["inferImagesOffset"]    = DEFAULT_INFER_IMAGES_OFFSET;
         (*conf)["inferImagesNumber"]    = DEFAULT_INFER_IMAGES_NUMBER;
+        (*conf)["inferScores"]          = DEFAULT_INFER_SCORES;
+        (*conf)["inferTopNumber"]       = DEFAULT_INFER_TOP_NUMBER;
+        (*conf)["ensembleFile"]         = DEFAULT_ENSEMBLE_FILE;
+        (*conf)["ensembleCombine"]      = DEFAULT_ENSEMBLE_COMBINE;
+        (*conf)["sweepFile"]            = DEFAULT_SWEEP_FILE;
+        (*conf)["sweepMode"]            = DEFAULT_SWEEP_MODE;
+        (*conf)["sweepTrialsNumber"]    = DEFAULT_SWEEP_TRIALS_NUMBER;
+        (*conf)["sweepConcurrency"]     = DEFAULT_SWEEP_CONCURRENCY;
+        (*conf)["sweepPruneAfter"]      = DEFAULT_SWEEP_PRUNE_AFTER;
+        (*conf)["sweepResultFile"]      = DEFAULT_SWEEP_RESULT_FILE;
+        (*conf)["streamLabels"]         = DEFAULT_STREAM_LABELS;
+        (*conf)["streamBatchSize"]      = DEFAULT_STREAM_BATCH_SIZE;
+        (*conf)["socketFile"]           = DEFAULT_SOCKET_FILE;
+        (*conf)["maxBatchSize"]         = DEFAULT_MAX_BATCH_SIZE;
+        (*conf)["maxBatchWait"]         = DEFAULT_MAX_BATCH_WAIT;
+        (*conf)["reportInterval"]       = DEFAULT_REPORT_INTERVAL;
+        (*conf)["serveRequestsNumber"]  = DEFAULT_SERVE_REQUESTS_NUMBER;
+        (*conf)["pruneSparsity"]        = DEFAULT_PRUNE_SPARSITY;
+        (*conf)["pruneEpochsNumber"]    = DEFAULT_PRUNE_EPOCHS_NUMBER;
+        (*conf)["prunedFile"]           = DEFAULT_PRUNED_FILE;
+        (*conf)["compressEnergy"]       = DEFAULT_COMPRESS_ENERGY;
+        (*conf)["compressMaxLoss"]      = DEFAULT_COMPRESS_MAX_LOSS;
+        (*conf)["compressOutput"]       = DEFAULT_COMPRESS_OUTPUT;
+        (*conf)["tuneBatchSizes"]       = DEFAULT_TUNE_BATCH_SIZES;
+        (*conf)["tuneThreads"]          = DEFAULT_TUNE_THREADS;
+        (*conf)["tuneRepeats"]          = DEFAULT_TUNE_REPEATS;
+        (*conf)["tuneResultFile"]       = DEFAULT_TUNE_RESULT_FILE;
         if (fileExist("default.config")) 
             setConfig(*openFile<ifstream>("default.config", ios::in), conf.get());
         setConfig(argc - 2, argv + 2, conf.get());
-        if (getWeightInitializations()->count((*conf)["weightInitialization"]) == 0) 
-            throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["weightInitialization"], "'Ƃdݏ͂܂B");
-        if (getCostFunctions()->count((*conf)["costFunction"]) == 0) 
-            throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["costFunction"], "'ƂRXg֐͂܂B");
-        if (getRegularizations()->count((*conf)["regularization"]) == 0) 
-            throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["regularization"], "'Ƃ͂܂B");
+        if (YES_OR_NO.count((*conf)["countAllocations"]) == 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'countAllocations'yes܂nołȂ΂Ȃ܂B");
+        if (getLogFormats()->count((*conf)["logFormat"]) == 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'", (*conf)["logFormat"], "'ƂǑ`͂܂B");
+        if (!(*conf)["seed"].empty()) 
+            Random::setSeed(s2ul((*conf)["seed"]));
+        *getPoolThreadsNumber() = s2ul((*conf)["threads"]);
+        if ((*conf)["numa"] != "auto" && 
+            (*conf)["numa"] != "off") 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'numa'auto܂offłȂ΂Ȃ܂B");
+        *getNumaAware() = (*conf)["numa"] == "auto";
+        if (getHugePagesPolicies()->count((*conf)["hugePages"]) == 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'hugePages'noAtransparent܂hugetlbłȂ΂Ȃ܂B");
+        *getHugePagesPolicy() = getHugePagesPolicies()->at((*conf)["hugePages"]);
+        if (YES_OR_NO.count((*conf)["perfCounters"]) == 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "'perfCounters'yes܂nołȂ΂Ȃ܂B");
+        *getPerfCountersEnabled() = YES_OR_NO.at((*conf)["perfCounters"]);
+        *getTraceEnabled() = !(*conf)["traceFile"].empty();
+        if (*getTraceEnabled()) 
+            Tracer::getInstance()->getThreadBuffer();
+        // f[^ZbgƌPlbg[N͎Xbhŏɏ̂ŁAXbhm[hɌŒ肷B
+        if (isNumaActive()) 
+            pinCurrentThread(getNumaCpus()[0]);
         auto hyperParameters = newInstance<HyperParameters>();
-        hyperParameters->weightInitialization = getWeightInitializations()->at((*conf)["weightInitialization"]).get();
-        hyperParameters->costFunction         = getCostFunctions()->at((*conf)["costFunction"]).get();
-        hyperParameters->regularization       = getRegularizations()->at((*conf)["regularization"]).get();
-        hyperParameters->weightDecayRate      = s2d((*conf)["weightDecayRate"]);
+        setHyperParameters(conf.get(), hyperParameters.get());
         getCommandProcs()->at(command)(conf.get(), hyperParameters.get());
+        if (*getTraceEnabled()) 
+            writeTrace(conf.get());
     } catch (const string &message) {
         cerr << message << endl;
         result = 1;
@@ -219,6 +656,215 @@ int main(int argc, char **argv) {
     return result;
 }
 
+// ȎSĂ̎ނsinkɏ悤ɂB
+shared_ptr<LogSink> setLogSink(map<string, string> *conf, Log *log) {
+    if ((*conf)["logFormat"] == "binary") 
+        setBinaryMode(stdout);
+    auto sink = getLogFormats()->at((*conf)["logFormat"])(&cout);
+    log->doneTrainEpoch = [sink](
+        const size_t &epochIndex, 
+        const size_t &trainCorrectAnswersNumber, 
+        const double &trainCost, 
+        const size_t &evalCorrectAnswersNumber, 
+        const double &evalCost) 
+    {
+        sink->put(
+            DONE_TRAIN_EPOCH, 
+            epochIndex, 
+            trainCorrectAnswersNumber, 
+            trainCost, 
+            evalCorrectAnswersNumber, 
+            evalCost);
+        sink->flush();
+    };
+    log->doneTrain = [sink](
+        const size_t &totalTrainCorrectAnswersNumber, 
+        const double &trainCostsAverage, 
+        const size_t &totalEvalCorrectAnswersNumber, 
+        const double &evalCostsAverage) 
+    {
+        sink->put(
+            DONE_TRAIN, 
+            totalTrainCorrectAnswersNumber, 
+            trainCostsAverage, 
+            totalEvalCorrectAnswersNumber, 
+            evalCostsAverage);
+    };
+    log->doneInferImage = [sink](
+        const size_t &inferImageIndex, 
+        const size_t &imageIndex, 
+        const size_t &label, 
+        const size_t &answer) 
+    {
+        sink->put(DONE_INFER_IMAGE, inferImageIndex, imageIndex, label, answer);
+    };
+    log->doneInfer = [sink](
+        const size_t &correctAnswersNumber, 
+        const double &cost) 
+    {
+        sink->put(DONE_INFER, correctAnswersNumber, cost);
+    };
+    auto putServeStatistics = [sink](
+        const LogRecordType &type, 
+        const size_t        &requestsNumber, 
+        const double        &throughput, 
+        const double        &latency50, 
+        const double        &latency90, 
+        const double        &latency99, 
+        const double        &batchSizeAverage) 
+    {
+        sink->put(type, requestsNumber, throughput, latency50, latency90, latency99, batchSizeAverage);
+        sink->flush();
+    };
+    log->doneServeInterval = bind(
+        putServeStatistics, 
+        DONE_SERVE_INTERVAL, 
+        placeholders::_1, 
+        placeholders::_2, 
+        placeholders::_3, 
+        placeholders::_4, 
+        placeholders::_5, 
+        placeholders::_6);
+    log->doneServe = bind(
+        putServeStatistics, 
+        DONE_SERVE, 
+        placeholders::_1, 
+        placeholders::_2, 
+        placeholders::_3, 
+        placeholders::_4, 
+        placeholders::_5, 
+        placeholders::_6);
+    log->doneInferModel = [sink](
+        const size_t &modelIndex, 
+        const size_t &correctAnswersNumber, 
+        const double &cost) 
+    {
+        sink->put(DONE_INFER_MODEL, modelIndex, correctAnswersNumber, cost);
+    };
+    log->donePrune = [sink](
+        const size_t &layerIndex, 
+        const size_t &weightsNumber, 
+        const size_t &nonzeroWeightsNumber) 
+    {
+        sink->put(DONE_PRUNE, layerIndex, weightsNumber, nonzeroWeightsNumber);
+    };
+    log->doneCompressLayer = [sink](
+        const size_t &layerIndex, 
+        const size_t &weightsNumber, 
+        const size_t &compressedWeightsNumber, 
+        const size_t &rank, 
+        const double &energy) 
+    {
+        sink->put(DONE_COMPRESS_LAYER, layerIndex, weightsNumber, compressedWeightsNumber, rank, energy);
+    };
+    log->doneCompress = [sink](
+        const size_t &correctAnswersNumber, 
+        const double &cost, 
+        const size_t &compressedCorrectAnswersNumber, 
+        const double &compressedCost) 
+    {
+        sink->put(DONE_COMPRESS, correctAnswersNumber, cost, compressedCorrectAnswersNumber, compressedCost);
+    };
+    log->doneTuneTrain = [sink](
+        const size_t &batchSize, 
+        const size_t &threadsNumber, 
+        const bool   &fastMath, 
+        const double &imagesPerSecond) 
+    {
+        sink->put(DONE_TUNE_TRAIN, batchSize, threadsNumber, (size_t)(fastMath ? 1 : 0), imagesPerSecond);
+    };
+    log->doneTuneInfer = [sink](
+        const size_t &threadsNumber, 
+        const bool   &fastMath, 
+        const double &imagesPerSecond) 
+    {
+        sink->put(DONE_TUNE_INFER, threadsNumber, (size_t)(fastMath ? 1 : 0), imagesPerSecond);
+    };
+    log->donePerfPhase = [sink](
+        const size_t   &epochIndex, 
+        const size_t   &phase, 
+        const uint64_t *counts) 
+    {
+        sink->put(
+            DONE_PERF_PHASE, 
+            epochIndex, 
+            phase, 
+            (size_t)counts[PERF_CYCLES], 
+            (size_t)counts[PERF_INSTRUCTIONS], 
+            (size_t)counts[PERF_L1D_MISSES], 
+            (size_t)counts[PERF_LLC_MISSES], 
+            (size_t)counts[PERF_DTLB_MISSES]);
+    };
+    log->doneInferScores = [sink](
+        const size_t &inferImageIndex, 
+        const size_t &imageIndex, 
+        const size_t *labels, 
+        const double *scores, 
+        const size_t &scoresNumber) 
+    {
+        sink->putRepeated(DONE_INFER_SCORES, labels, scores, scoresNumber, inferImageIndex, imageIndex);
+    };
+    if (YES_OR_NO.at((*conf)["countAllocations"])) {
+        log->doneCountAllocations = [sink](const size_t &allocationsNumber) {
+            sink->put(DONE_COUNT_ALLOCATIONS, allocationsNumber);
+        };
+    }
+    return sink;
+}
+
+template <typename Inferrer> 
+void setInferScores(map<string, string> *conf, Inferrer *net) {
+    if ((*conf)["inferScores"] == "all") 
+        net->setInferScores(LABEL_VALUES_NUMBER, false);
+    else if ((*conf)["inferScores"] == "top") 
+        net->setInferScores(s2ul((*conf)["inferTopNumber"]), true);
+    else if ((*conf)["inferScores"] != "no") 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'inferScores'noAall܂topłȂ΂Ȃ܂B");
+}
+
+// Plbg[N̒`ǂݍ݁AhbvAEg̐ݒ肪Αw̐ݒɕtB
+string readTrainNetwork(map<string, string> *conf) {
+    string network = DEFAULT_NETWORK;
+    if (!(*conf)["networkFile"].empty() && 
+        fileExist((*conf)["networkFile"])) 
+    {
+        auto networkIS = openFile<ifstream>((*conf)["networkFile"], ios::in);
+        network.assign(istreambuf_iterator<char>(*networkIS), istreambuf_iterator<char>());
+    }
+    if (!(*conf)["inputDropout"].empty()) 
+        network = appendLayerSetting(network, "input", "dropoutRatio=" + (*conf)["inputDropout"]);
+    if (!(*conf)["hiddenDropout"].empty()) 
+        network = appendLayerSetting(network, "fullyConnected", "dropoutRatio=" + (*conf)["hiddenDropout"]);
+    return network;
+}
+
+// Pɕ]lbg[Nnetɐݒ肷B
+void setTrainEvaluation(
+    map<string, string> *conf, 
+    HyperParameters     *hyperParameters, 
+    const string        &network, 
+    Network             *net) 
+{
+    // ]p̃lbg[Ñp[^͕]̂тɎʂ̂ŁAŌP̗Ȃ悤ɂB
+    Random random = *Random::getInstance();
+    auto evalNet = NetworkBuilder::getInstance()->build(
+        *newInstance<stringstream>(network), 
+        hyperParameters, 
+        newInstance<Log>(), 
+        INFERENCE_MODE);
+    *Random::getInstance() = random;
+    net->setEvaluation(
+        evalNet, 
+        s2ul((*conf)["evalEvery"]), 
+        s2ul((*conf)["evalSubsample"]));
+}
+
+void setCacheFrozen(map<string, string> *conf, Network *net) {
+    if (YES_OR_NO.count((*conf)["cacheFrozen"]) == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'cacheFrozen'yes܂nołȂ΂Ȃ܂B");
+    net->setCachesFrozenOutputs(YES_OR_NO.at((*conf)["cacheFrozen"]));
+}
+
 void train(map<string, string> *conf, HyperParameters *hyperParameters) {
     if (YES_OR_NO.count((*conf)["readParameters"]) == 0) 
         throw describe(__FILE__, "(", __LINE__, "): " , "'readParameters'yes܂nołȂ΂Ȃ܂B");
@@ -230,61 +876,90 @@ void train(map<string, string> *conf, HyperParameters *hyperParameters) {
         *openFile<ifstream>((*conf)["evalImagesFile"], ios::in | ios::binary), 
         *openFile<ifstream>((*conf)["evalLabelsFile"], ios::in | ios::binary));
     
-    shared_ptr<istream> networkIS;
-    if ((*conf)["networkFile"].empty() || 
-        !fileExist((*conf)["networkFile"])) 
-        networkIS = newInstance<stringstream>(DEFAULT_NETWORK);
-    else
-        networkIS = openFile<ifstream>((*conf)["networkFile"], ios::in);
+    size_t workersNumber = s2ul((*conf)["workers"]);
+    size_t trainImagesNumber = s2ul((*conf)["trainImagesNumber"]);
+    if (workersNumber != 0 && trainImagesNumber % workersNumber != 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'trainImagesNumber''workers'Ŋ؂Ȃ΂Ȃ܂B");
+    // Xbhv[OforkBǂ̃vZXǂݍ񂾉摜LA
+    // ̏Ԃ瓯l̃lbg[NB
+    auto allreducer = forkRing(workersNumber, (*conf)["allreduce"]);
+    size_t rank = allreducer ? allreducer->getRank() : 0;
+    Tracer::getInstance()->setProcessIndex(rank);
+    // qvZX͎XbȟŒp̂ŁAʂƂCPU𕪂ČŒ肵B
+    // XbhvZX킹threads̃XbhɂȂ悤ɕB
+    if (allreducer) {
+        size_t threadsNumber = countPoolThreads();
+        *getPoolThreadsNumber() = max<size_t>(
+            threadsNumber / workersNumber + (rank < threadsNumber % workersNumber ? 1 : 0), 
+            1);
+        *getNumaRank() = {rank, workersNumber};
+        if (isNumaActive()) 
+            pinCurrentThread(getNumaCpus()[0]);
+    }
+    
+    string network = readTrainNetwork(conf);
     hyperParameters->learningRate = s2d((*conf)["learningRate"]);
     auto log = newInstance<Log>();
+    auto sink = rank == 0 ? setLogSink(conf, log.get()) : nullptr;
     auto net = NetworkBuilder::getInstance()->build(
-        *networkIS, 
+        *newInstance<stringstream>(network), 
         hyperParameters, 
-        log);
+        log, 
+        TRAINING_MODE);
     if (fileExist((*conf)["parametersFile"]) && 
         YES_OR_NO.at((*conf)["readParameters"])) 
         net->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+    setTrainEvaluation(conf, hyperParameters, network, net.get());
+    setCacheFrozen(conf, net.get());
+    net->setAllreducer(allreducer);
     
-    log->doneTrainEpoch = [](
-        const size_t &epochIndex, 
-        const size_t &trainCorrectAnswersNumber, 
-        const double &trainCost, 
-        const size_t &evalCorrectAnswersNumber, 
-        const double &evalCost) 
-    {
-        cout << 
-            "doneTrainEpoch"          << "\t" << 
-            epochIndex                << "\t" << 
-            trainCorrectAnswersNumber << "\t" << 
-            trainCost                 << "\t" << 
-            evalCorrectAnswersNumber  << "\t" << 
-            evalCost                  << endl;
-    };
-    log->doneTrain = [](
-        const size_t &totalTrainCorrectAnswersNumber, 
-        const double &trainCostsAverage, 
-        const size_t &totalEvalCorrectAnswersNumber, 
-        const double &evalCostsAverage) 
-    {
-        cout << 
-            "doneTrain"                    << "\t" << 
-            totalTrainCorrectAnswersNumber << "\t" << 
-            trainCostsAverage              << "\t" << 
-            totalEvalCorrectAnswersNumber  << "\t" << 
-            evalCostsAverage               << endl;
-    };
+    size_t shardImagesNumber = trainImagesNumber / workersNumber;
     net->train(
         s2ul((*conf)["epochsNumber"]), 
         s2ul((*conf)["batchSize"]), 
         trainMNIST.get(), 
-        s2ul((*conf)["trainImagesOffset"]), 
-        s2ul((*conf)["trainImagesNumber"]), 
+        s2ul((*conf)["trainImagesOffset"]) + shardImagesNumber * rank, 
+        shardImagesNumber, 
         evalMNIST.get(), 
         s2ul((*conf)["evalImagesOffset"]), 
-        s2ul((*conf)["evalImagesNumber"]));
+        rank == 0 ? s2ul((*conf)["evalImagesNumber"]) : 0);
+    if (rank != 0) 
+        return;
     
-    net->write(*openFile<ofstream>((*conf)["parametersFile"], ios::out | ios::binary | ios::trunc));
+    {
+        TraceSpan span("checkpoint");
+        net->write(*openFile<ofstream>((*conf)["parametersFile"], ios::out | ios::binary | ios::trunc));
+    }
+    sink->flush();
+    if (allreducer) 
+        allreducer->waitChildren();
+}
+
+void inferEnsemble(
+    map<string, string>   *conf, 
+    HyperParameters       *hyperParameters, 
+    MNIST                 *mnist, 
+    const shared_ptr<Log> &log) 
+{
+    if ((*conf)["ensembleCombine"] != "mean" && 
+        (*conf)["ensembleCombine"] != "vote") 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'ensembleCombine'mean܂votełȂ΂Ȃ܂B");
+    vector<shared_ptr<Network>> nets;
+    for (auto &m : readEnsembleModels(*openFile<ifstream>((*conf)["ensembleFile"], ios::in))) {
+        auto net = NetworkBuilder::getInstance()->build(
+            *openFile<ifstream>(m.first, ios::in), 
+            hyperParameters, 
+            log, 
+            INFERENCE_MODE);
+        net->read(*openFile<ifstream>(m.second, ios::in | ios::binary));
+        nets.push_back(net);
+    }
+    Ensemble ensemble(nets, log, (*conf)["ensembleCombine"] == "vote");
+    setInferScores(conf, &ensemble);
+    ensemble.infer(
+        mnist, 
+        s2ul((*conf)["inferImagesOffset"]), 
+        s2ul((*conf)["inferImagesNumber"]));
 }
 
 void infer(map<string, string> *conf, HyperParameters *hyperParameters) {
@@ -293,37 +968,565 @@ void infer(map<string, string> *conf, HyperParameters *hyperParameters) {
         *openFile<ifstream>((*conf)["inferLabelsFile"], ios::in | ios::binary));
     
     auto log = newInstance<Log>();
+    auto sink = setLogSink(conf, log.get());
+    if (!(*conf)["ensembleFile"].empty()) {
+        inferEnsemble(conf, hyperParameters, mnist.get(), log);
+        sink->flush();
+        return;
+    }
     auto net = NetworkBuilder::getInstance()->build(
         *openFile<ifstream>((*conf)["networkFile"], ios::in), 
         hyperParameters, 
-        log);
+        log, 
+        INFERENCE_MODE);
     if (fileExist((*conf)["parametersFile"])) 
         net->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+    setInferScores(conf, net.get());
     
-    log->doneInferImage = [](
-        const size_t &inferImageIndex, 
-        const size_t &imageIndex, 
-        const size_t &label, 
-        const size_t &answer) 
-    {
-        cout << 
-            "doneInferImage" << "\t" << 
-            inferImageIndex  << "\t" << 
-            imageIndex       << "\t" << 
-            label            << "\t" << 
-            answer           << endl;
-    };
-    log->doneInfer = [](
-        const size_t &correctAnswersNumber, 
-        const double &cost) 
-    {
-        cout << 
-            "doneInfer"          << "\t" << 
-            correctAnswersNumber << "\t" << 
-            cost                 << endl;
-    };
     net->infer(
         mnist.get(), 
         s2ul((*conf)["inferImagesOffset"]), 
         s2ul((*conf)["inferImagesNumber"]));
+    sink->flush();
+}
+
+void stream(map<string, string> *conf, HyperParameters *hyperParameters) {
+    if (YES_OR_NO.count((*conf)["streamLabels"]) == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'streamLabels'yes܂nołȂ΂Ȃ܂B");
+    bool hasLabels = YES_OR_NO.at((*conf)["streamLabels"]);
+    size_t batchSize = s2ul((*conf)["streamBatchSize"]);
+    if (batchSize == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'streamBatchSize'1ȏłȂ΂Ȃ܂B");
+    
+    auto log = newInstance<Log>();
+    auto sink = setLogSink(conf, log.get());
+    auto net = NetworkBuilder::getInstance()->build(
+        *openFile<ifstream>((*conf)["networkFile"], ios::in), 
+        hyperParameters, 
+        log, 
+        INFERENCE_MODE);
+    if (fileExist((*conf)["parametersFile"])) 
+        net->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+    setInferScores(conf, net.get());
+    
+    if (!hasLabels) {
+        log->doneInferImage = [sink](
+            const size_t &inferImageIndex, 
+            const size_t &imageIndex, 
+            const size_t &label, 
+            const size_t &answer) 
+        {
+            sink->put(DONE_STREAM_IMAGE, imageIndex, answer);
+        };
+    }
+    log->doneInferBatch = [sink]() {
+        sink->flush();
+    };
+    
+    auto batchMNIST = newInstance<MNIST>(batchSize);
+    for (auto i = 0; i < batchSize; i++) 
+        (*batchMNIST)[i] = newInstance<Image>(i);
+    RawImageStream imageStream(0, hasLabels, batchSize);
+    net->inferStream(
+        batchMNIST.get(), 
+        [&imageStream](MNIST *images) {
+            return imageStream.read(images);
+        }, 
+        hasLabels);
+    sink->flush();
+}
+
+void serve(map<string, string> *conf, HyperParameters *hyperParameters) {
+    size_t maxBatchSize = s2ul((*conf)["maxBatchSize"]);
+    if (maxBatchSize == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'maxBatchSize'1ȏłȂ΂Ȃ܂B");
+    
+    auto log = newInstance<Log>();
+    auto sink = setLogSink(conf, log.get());
+    auto net = NetworkBuilder::getInstance()->build(
+        *openFile<ifstream>((*conf)["networkFile"], ios::in), 
+        hyperParameters, 
+        log, 
+        INFERENCE_MODE);
+    if (fileExist((*conf)["parametersFile"])) 
+        net->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+    
+    InferenceServer(
+        net.get(), 
+        log, 
+        (*conf)["socketFile"], 
+        maxBatchSize, 
+        s2ul((*conf)["maxBatchWait"]), 
+        s2ul((*conf)["reportInterval"]), 
+        s2ul((*conf)["serveRequestsNumber"])).run();
+    sink->flush();
+}
+
+struct SweepResult {
+    size_t epochsNumber;
+    size_t evalCorrectAnswersNumber;
+    double evalCost;
+    bool   pruned;
+};
+
+const vector<string> SWEEP_SETTING_NAMES = {
+    "networkFile", 
+    "learningRate", 
+    "batchSize", 
+    "weightDecayRate", 
+    "regularization", 
+    "costFunction", 
+    "inputDropout", 
+    "hiddenDropout", 
+    "epochsNumber", 
+};
+
+// 1̎s1ジPAゲƂɑł؂邩ǂ߂B
+SweepResult runSweepTrial(
+    map<string, string> *conf, 
+    const size_t        &trialIndex, 
+    MNIST               *trainMNIST, 
+    MNIST               *evalMNIST, 
+    MedianPruner        *pruner, 
+    LogSink             *sink, 
+    mutex               *sinkMutex) 
+{
+    Random::setStream(SWEEP_RANDOM_STREAM + trialIndex);
+    HyperParameters hyperParameters;
+    setHyperParameters(conf, &hyperParameters);
+    hyperParameters.learningRate = s2d((*conf)["learningRate"]);
+    size_t epochTrainCorrectAnswersNumber = 0;
+    double epochTrainCost                 = 0.0;
+    size_t epochEvalCorrectAnswersNumber  = 0;
+    double epochEvalCost                  = 0.0;
+    auto log = newInstance<Log>();
+    log->doneTrainEpoch = [&](
+        const size_t &epochIndex, 
+        const size_t &trainCorrectAnswersNumber, 
+        const double &trainCost, 
+        const size_t &evalCorrectAnswersNumber, 
+        const double &evalCost) 
+    {
+        epochTrainCorrectAnswersNumber = trainCorrectAnswersNumber;
+        epochTrainCost                 = trainCost;
+        epochEvalCorrectAnswersNumber  = evalCorrectAnswersNumber;
+        epochEvalCost                  = evalCost;
+    };
+    auto net = NetworkBuilder::getInstance()->build(
+        *newInstance<stringstream>(readTrainNetwork(conf)), 
+        &hyperParameters, 
+        log, 
+        TRAINING_MODE);
+    
+    SweepResult result = {0, 0, 0.0, false};
+    size_t epochsNumber = s2ul((*conf)["epochsNumber"]);
+    while (result.epochsNumber < epochsNumber && !result.pruned) {
+        net->train(
+            1, 
+            s2ul((*conf)["batchSize"]), 
+            trainMNIST, 
+            s2ul((*conf)["trainImagesOffset"]), 
+            s2ul((*conf)["trainImagesNumber"]), 
+            evalMNIST, 
+            s2ul((*conf)["evalImagesOffset"]), 
+            s2ul((*conf)["evalImagesNumber"]));
+        result.evalCorrectAnswersNumber = epochEvalCorrectAnswersNumber;
+        result.evalCost                 = epochEvalCost;
+        result.pruned = pruner->report(result.epochsNumber, epochEvalCorrectAnswersNumber);
+        lock_guard<mutex> lock(*sinkMutex);
+        sink->put(
+            DONE_SWEEP_EPOCH, 
+            trialIndex, 
+            result.epochsNumber++, 
+            epochTrainCorrectAnswersNumber, 
+            epochTrainCost, 
+            epochEvalCorrectAnswersNumber, 
+            epochEvalCost);
+        sink->flush();
+    }
+    lock_guard<mutex> lock(*sinkMutex);
+    sink->put(
+        DONE_SWEEP_TRIAL, 
+        trialIndex, 
+        result.epochsNumber, 
+        result.evalCorrectAnswersNumber, 
+        result.evalCost, 
+        (size_t)(result.pruned ? 1 : 0));
+    sink->flush();
+    return result;
+}
+
+void sweep(map<string, string> *conf, HyperParameters *hyperParameters) {
+    SweepSpec spec(*openFile<ifstream>((*conf)["sweepFile"], ios::in), SWEEP_SETTING_NAMES);
+    vector<SweepTrial> trials;
+    if ((*conf)["sweepMode"] == "grid") 
+        trials = spec.makeGridTrials();
+    else if ((*conf)["sweepMode"] == "random") 
+        trials = spec.makeRandomTrials(s2ul((*conf)["sweepTrialsNumber"]));
+    else 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'sweepMode'grid܂randomłȂ΂Ȃ܂B");
+    if (trials.empty()) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "s܂B");
+    
+    auto trainMNIST = readMNIST(
+        *openFile<ifstream>((*conf)["trainImagesFile"], ios::in | ios::binary), 
+        *openFile<ifstream>((*conf)["trainLabelsFile"], ios::in | ios::binary));
+    auto evalMNIST = readMNIST(
+        *openFile<ifstream>((*conf)["evalImagesFile"], ios::in | ios::binary), 
+        *openFile<ifstream>((*conf)["evalLabelsFile"], ios::in | ios::binary));
+    
+    auto log = newInstance<Log>();
+    auto sink = setLogSink(conf, log.get());
+    mutex sinkMutex;
+    MedianPruner pruner(s2ul((*conf)["sweepPruneAfter"]));
+    size_t poolThreadsNumber = getThreadPool()->getThreadsNumber();
+    size_t concurrency = s2ul((*conf)["sweepConcurrency"]);
+    if (concurrency == 0) 
+        concurrency = poolThreadsNumber;
+    concurrency = min(min(concurrency, poolThreadsNumber), trials.size());
+    size_t threadsBudget = max<size_t>(poolThreadsNumber / concurrency, 1);
+    
+    vector<SweepResult> results(trials.size());
+    atomic<size_t> nextTrialIndex(0);
+    mutex errorMutex;
+    string error;
+    // s̓Xbhv[̎dƂčsAIΎdXbh̗\Zɖ߂B
+    auto runTrials = [&](const size_t &begin, const size_t &end) {
+        size_t savedThreadsBudget = *getThreadsBudget();
+        *getThreadsBudget() = threadsBudget;
+        for (size_t i; (i = nextTrialIndex.fetch_add(1)) < trials.size();) {
+            try {
+                map<string, string> trialConf = *conf;
+                for (auto &s : trials[i]) 
+                    trialConf[s.first] = s.second;
+                results[i] = runSweepTrial(
+                    &trialConf, 
+                    i, 
+                    trainMNIST.get(), 
+                    evalMNIST.get(), 
+                    &pruner, 
+                    sink.get(), 
+                    &sinkMutex);
+            } catch (const string &message) {
+                lock_guard<mutex> lock(errorMutex);
+                if (error.empty()) 
+                    error = message;
+                nextTrialIndex.store(trials.size());
+            }
+        }
+        *getThreadsBudget() = savedThreadsBudget;
+    };
+    getThreadPool()->parallelFor(concurrency, concurrency, runTrials);
+    if (!error.empty()) 
+        throw error;
+    
+    size_t bestTrialIndex = 0;
+    for (size_t i = 1; i < results.size(); i++) {
+        if (results[i].evalCorrectAnswersNumber > results[bestTrialIndex].evalCorrectAnswersNumber || 
+            (results[i].evalCorrectAnswersNumber == results[bestTrialIndex].evalCorrectAnswersNumber && 
+            results[i].evalCost < results[bestTrialIndex].evalCost)) 
+            bestTrialIndex = i;
+    }
+    auto resultOS = openFile<ofstream>((*conf)["sweepResultFile"], ios::out | ios::trunc);
+    for (size_t i = 0; i < results.size(); i++) {
+        *resultOS << 
+            "# trial="       << i                                   << " " << 
+            "epochs="        << results[i].epochsNumber             << " " << 
+            "evalCorrect="   << results[i].evalCorrectAnswersNumber << " " << 
+            "evalCost="      << results[i].evalCost                 << " " << 
+            "pruned="        << (results[i].pruned ? "yes" : "no");
+        for (auto &s : trials[i]) 
+            *resultOS << " " << s.first << "=" << s.second;
+        *resultOS << "\n";
+    }
+    *resultOS << "# best trial=" << bestTrialIndex << "\n";
+    for (auto &s : trials[bestTrialIndex]) 
+        *resultOS << s.first << "=" << s.second << "\n";
+    sink->flush();
+}
+
+void prune(map<string, string> *conf, HyperParameters *hyperParameters) {
+    double sparsity = s2d((*conf)["pruneSparsity"]);
+    if (sparsity < 0.0 || sparsity >= 1.0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'pruneSparsity'0ȏ1łȂ΂Ȃ܂B");
+    size_t epochsNumber = s2ul((*conf)["pruneEpochsNumber"]);
+    
+    string network = readTrainNetwork(conf);
+    hyperParameters->learningRate = s2d((*conf)["learningRate"]);
+    auto log = newInstance<Log>();
+    auto sink = setLogSink(conf, log.get());
+    auto net = NetworkBuilder::getInstance()->build(
+        *newInstance<stringstream>(network), 
+        hyperParameters, 
+        log, 
+        TRAINING_MODE);
+    net->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+    net->prune(sparsity);
+    
+    if (epochsNumber != 0) {
+        auto trainMNIST = readMNIST(
+            *openFile<ifstream>((*conf)["trainImagesFile"], ios::in | ios::binary), 
+            *openFile<ifstream>((*conf)["trainLabelsFile"], ios::in | ios::binary));
+        auto evalMNIST = readMNIST(
+            *openFile<ifstream>((*conf)["evalImagesFile"], ios::in | ios::binary), 
+            *openFile<ifstream>((*conf)["evalLabelsFile"], ios::in | ios::binary));
+        setTrainEvaluation(conf, hyperParameters, network, net.get());
+        setCacheFrozen(conf, net.get());
+        net->train(
+            epochsNumber, 
+            s2ul((*conf)["batchSize"]), 
+            trainMNIST.get(), 
+            s2ul((*conf)["trainImagesOffset"]), 
+            s2ul((*conf)["trainImagesNumber"]), 
+            evalMNIST.get(), 
+            s2ul((*conf)["evalImagesOffset"]), 
+            s2ul((*conf)["evalImagesNumber"]));
+    }
+    
+    net->writeSparse(*openFile<ofstream>((*conf)["prunedFile"], ios::out | ios::binary | ios::trunc));
+    sink->flush();
+}
+
+// ranks̑w𕪂lbg[NAnet̃p[^ʂB
+shared_ptr<Network> buildCompressedNetwork(
+    HyperParameters                                     *hyperParameters, 
+    const string                                        &network, 
+    Network                                             *net, 
+    const map<size_t, shared_ptr<LowRankFactorization>> &factorizations, 
+    const map<size_t, size_t>                           &ranks) 
+{
+    auto compressedNet = NetworkBuilder::getInstance()->build(
+        *newInstance<stringstream>(insertLowRankLayers(network, ranks)), 
+        hyperParameters, 
+        newInstance<Log>(), 
+        INFERENCE_MODE);
+    compressedNet->copyFactorizedParameters(net, factorizations, ranks);
+    return compressedNet;
+}
+
+void compress(map<string, string> *conf, HyperParameters *hyperParameters) {
+    double energy = s2d((*conf)["compressEnergy"]);
+    if (energy <= 0.0 || energy > 1.0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'compressEnergy'0傫1ȉłȂ΂Ȃ܂B");
+    bool boundsLoss = !(*conf)["compressMaxLoss"].empty();
+    double maxLoss = boundsLoss ? s2d((*conf)["compressMaxLoss"]) : 0.0;
+    if (maxLoss < 0.0 || maxLoss >= 1.0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'compressMaxLoss'0ȏ1łȂ΂Ȃ܂B");
+    
+    string network = readTrainNetwork(conf);
+    auto log = newInstance<Log>();
+    auto sink = setLogSink(conf, log.get());
+    auto net = NetworkBuilder::getInstance()->build(
+        *newInstance<stringstream>(network), 
+        hyperParameters, 
+        log, 
+        INFERENCE_MODE);
+    net->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+    auto evalMNIST = readMNIST(
+        *openFile<ifstream>((*conf)["evalImagesFile"], ios::in | ios::binary), 
+        *openFile<ifstream>((*conf)["evalLabelsFile"], ios::in | ios::binary));
+    size_t evalImagesOffset = s2ul((*conf)["evalImagesOffset"]);
+    size_t evalImagesNumber = s2ul((*conf)["evalImagesNumber"]);
+    auto result = net->evaluate(evalMNIST.get(), evalImagesOffset, evalImagesNumber);
+    
+    // ̐͊Kɑ΂Ă悻Pɑ̂ŁA̐ȏɂȂŏ̊K񕪒TB
+    size_t lostAnswersNumber = (size_t)(maxLoss * (double)result.imagesNumber);
+    size_t minCorrectAnswersNumber = 
+        result.correctAnswersNumber - min(lostAnswersNumber, result.correctAnswersNumber);
+    auto factorizations = net->factorizeHiddenLayers();
+    map<size_t, size_t> ranks;
+    for (auto &f : factorizations) {
+        auto factorization = f.second.get();
+        size_t rank = factorization->computeRank(energy);
+        if (boundsLoss) {
+            size_t lower = 1;
+            size_t upper = factorization->getMaxRank();
+            while (lower < upper) {
+                ranks[f.first] = (lower + upper) / 2;
+                auto candidate = buildCompressedNetwork(hyperParameters, network, net.get(), factorizations, ranks);
+                if (candidate->evaluate(evalMNIST.get(), evalImagesOffset, evalImagesNumber).correctAnswersNumber >= 
+                    minCorrectAnswersNumber) 
+                    upper = ranks[f.first];
+                else 
+                    lower = ranks[f.first] + 1;
+            }
+            rank = lower;
+        }
+        // 2̑wɂĂϘaȂΕȂB
+        if (factorization->computeWeightsNumber(rank) >= factorization->getWeightsNumber()) {
+            ranks.erase(f.first);
+            rank = factorization->getMaxRank();
+        } else {
+            ranks[f.first] = rank;
+        }
+        log->doneCompressLayer(
+            f.first, 
+            factorization->getWeightsNumber(), 
+            ranks.count(f.first) != 0 ? 
+                factorization->computeWeightsNumber(rank) : 
+                factorization->getWeightsNumber(), 
+            rank, 
+            factorization->computeEnergy(rank));
+    }
+    
+    auto compressedNet = buildCompressedNetwork(hyperParameters, network, net.get(), factorizations, ranks);
+    auto compressedResult = compressedNet->evaluate(evalMNIST.get(), evalImagesOffset, evalImagesNumber);
+    log->doneCompress(
+        result.correctAnswersNumber, 
+        (result.costsSum + net->computeWeightsCost()) / (double)result.imagesNumber, 
+        compressedResult.correctAnswersNumber, 
+        (compressedResult.costsSum + compressedNet->computeWeightsCost()) / (double)compressedResult.imagesNumber);
+    
+    *openFile<ofstream>((*conf)["compressOutput"] + ".network", ios::out | ios::trunc) << insertLowRankLayers(network, ranks);
+    compressedNet->write(*openFile<ofstream>((*conf)["compressOutput"] + ".parameters", ios::out | ios::binary | ios::trunc));
+    sink->flush();
+}
+
+// ','ŋ؂1ȏ̐̕тǂށB
+vector<size_t> readTuneList(map<string, string> *conf, const string &name) {
+    vector<size_t> values;
+    tokenize((*conf)[name], ",", true, [&values](const string &token) {
+        values.push_back(s2ul(token));
+    });
+    if (values.empty() || 
+        find(values.begin(), values.end(), 0) != values.end()) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'", name, "'1ȏ̐','ŋ؂ĕׂȂ΂Ȃ܂B");
+    return values;
+}
+
+// runrepeatsNumber񑪂A1bɏ摜̐̒lԂB
+template <typename Run> 
+double measureImagesPerSecond(
+    const size_t &imagesNumber, 
+    const size_t &repeatsNumber, 
+    Run           run) 
+{
+    vector<double> rates;
+    for (size_t i = 0; i < repeatsNumber; i++) {
+        auto startTime = chrono::steady_clock::now();
+        run();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        rates.push_back((double)imagesNumber / max(seconds, 1e-9));
+    }
+    nth_element(rates.begin(), rates.begin() + repeatsNumber / 2, rates.end());
+    return rates[repeatsNumber / 2];
+}
+
+void tune(map<string, string> *conf, HyperParameters *hyperParameters) {
+    auto batchSizes = readTuneList(conf, "tuneBatchSizes");
+    size_t poolThreadsNumber = getThreadPool()->getThreadsNumber();
+    vector<size_t> threadsNumbers;
+    if ((*conf)["tuneThreads"].empty()) {
+        for (size_t t = 1; t < poolThreadsNumber; t *= 2) 
+            threadsNumbers.push_back(t);
+        threadsNumbers.push_back(poolThreadsNumber);
+    } else {
+        threadsNumbers = readTuneList(conf, "tuneThreads");
+    }
+    if (*max_element(threadsNumbers.begin(), threadsNumbers.end()) > poolThreadsNumber) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'tuneThreads'threads̃XbhȉłȂ΂Ȃ܂B");
+    size_t repeatsNumber = s2ul((*conf)["tuneRepeats"]);
+    if (repeatsNumber == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'tuneRepeats'1ȏłȂ΂Ȃ܂B");
+    size_t imagesOffset = s2ul((*conf)["trainImagesOffset"]);
+    size_t imagesNumber = s2ul((*conf)["trainImagesNumber"]);
+    if (imagesNumber == 0) 
+        throw describe(__FILE__, "(", __LINE__, "): " , "'trainImagesNumber'1ȏłȂ΂Ȃ܂B");
+    
+    string network = readTrainNetwork(conf);
+    hyperParameters->learningRate = s2d((*conf)["learningRate"]);
+    auto log = newInstance<Log>();
+    auto sink = setLogSink(conf, log.get());
+    auto trainMNIST = readMNIST(
+        *openFile<ifstream>((*conf)["trainImagesFile"], ios::in | ios::binary), 
+        *openFile<ifstream>((*conf)["trainLabelsFile"], ios::in | ios::binary));
+    bool readsParameters = fileExist((*conf)["parametersFile"]);
+    auto resultOS = openFile<ofstream>((*conf)["tuneResultFile"], ios::out | ios::trunc);
+    
+    size_t bestBatchSize = batchSizes[0];
+    bool bestFastMath = false;
+    double bestTrainRate = 0.0;
+    for (bool fastMath : {false, true}) {
+        hyperParameters->fastMath = fastMath;
+        auto net = NetworkBuilder::getInstance()->build(
+            *newInstance<stringstream>(network), 
+            hyperParameters, 
+            newInstance<Log>(), 
+            TRAINING_MODE);
+        if (readsParameters) 
+            net->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+        // O1xPāAy[WƃLbV߂ĂB
+        net->train(1, batchSizes[0], trainMNIST.get(), imagesOffset, imagesNumber, trainMNIST.get(), 0, 0);
+        for (auto batchSize : batchSizes) {
+            double rate = measureImagesPerSecond(imagesNumber, repeatsNumber, [&]() {
+                net->train(1, batchSize, trainMNIST.get(), imagesOffset, imagesNumber, trainMNIST.get(), 0, 0);
+            });
+            log->doneTuneTrain(batchSize, poolThreadsNumber, fastMath, rate);
+            *resultOS << 
+                "# train batchSize=" << batchSize                   << " " << 
+                "threads="           << poolThreadsNumber           << " " << 
+                "fastMath="          << (fastMath ? "yes" : "no")  << " " << 
+                "imagesPerSecond="   << rate                        << "\n";
+            if (rate > bestTrainRate) {
+                bestTrainRate = rate;
+                bestBatchSize = batchSize;
+                bestFastMath  = fastMath;
+            }
+        }
+    }
+    
+    hyperParameters->fastMath = bestFastMath;
+    size_t savedThreadsBudget = *getThreadsBudget();
+    auto trainNet = NetworkBuilder::getInstance()->build(
+        *newInstance<stringstream>(network), 
+        hyperParameters, 
+        newInstance<Log>(), 
+        TRAINING_MODE);
+    if (readsParameters) 
+        trainNet->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+    trainNet->train(1, bestBatchSize, trainMNIST.get(), imagesOffset, imagesNumber, trainMNIST.get(), 0, 0);
+    size_t bestThreadsNumber = threadsNumbers[0];
+    double bestThreadsTrainRate = 0.0;
+    for (auto threadsNumber : threadsNumbers) {
+        *getThreadsBudget() = threadsNumber;
+        double rate = measureImagesPerSecond(imagesNumber, repeatsNumber, [&]() {
+            trainNet->train(1, bestBatchSize, trainMNIST.get(), imagesOffset, imagesNumber, trainMNIST.get(), 0, 0);
+        });
+        log->doneTuneTrain(bestBatchSize, threadsNumber, bestFastMath, rate);
+        *resultOS << 
+            "# train batchSize=" << bestBatchSize                   << " " << 
+            "threads="           << threadsNumber                   << " " << 
+            "fastMath="          << (bestFastMath ? "yes" : "no")  << " " << 
+            "imagesPerSecond="   << rate                            << "\n";
+        if (rate > bestThreadsTrainRate) {
+            bestThreadsTrainRate = rate;
+            bestThreadsNumber    = threadsNumber;
+        }
+    }
+    
+    auto net = NetworkBuilder::getInstance()->build(
+        *newInstance<stringstream>(network), 
+        hyperParameters, 
+        newInstance<Log>(), 
+        INFERENCE_MODE);
+    if (readsParameters) 
+        net->read(*openFile<ifstream>((*conf)["parametersFile"], ios::in | ios::binary));
+    net->evaluate(trainMNIST.get(), imagesOffset, imagesNumber);
+    for (auto threadsNumber : threadsNumbers) {
+        *getThreadsBudget() = threadsNumber;
+        double rate = measureImagesPerSecond(imagesNumber, repeatsNumber, [&]() {
+            net->evaluate(trainMNIST.get(), imagesOffset, imagesNumber);
+        });
+        log->doneTuneInfer(threadsNumber, bestFastMath, rate);
+        *resultOS << 
+            "# infer threads=" << threadsNumber << " " << 
+            "imagesPerSecond=" << rate          << "\n";
+    }
+    *getThreadsBudget() = savedThreadsBudget;
+    
+    *resultOS << "# best\n";
+    *resultOS << "batchSize=" << bestBatchSize << "\n";
+    *resultOS << "threads="   << bestThreadsNumber << "\n";
+    *resultOS << "fastMath="  << (bestFastMath ? "yes" : "no") << "\n";
+    sink->flush();
 }
@@ -0,0 +1,179 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include "pages.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// ׂNUMAm[h̔ԍ̏B
+constexpr size_t NUMA_MAX_NODES = 64;
+
+// mbind̕jB
+constexpr int NUMA_MPOL_BIND = 2;
+
+struct NumaCpu {
+    size_t cpu;
+    size_t node;
+};
+
+// numaݒ肪autoȂtrueBgetThreadPoolŏɌĂԑOɌ߂B
+inline bool *getNumaAware() {
+    static bool NUMA_AWARE = false;
+    return &NUMA_AWARE;
+}
+
+// UPforkvZX̏ʂƏʂ̐BforkAgetThreadPoolŏɌĂԑOɌ߂B
+struct NumaRank {
+    size_t rank;
+    size_t ranksNumber;
+};
+
+inline NumaRank *getNumaRank() {
+    static NumaRank NUMA_RANK = {0, 1};
+    return &NUMA_RANK;
+}
+
+// '0-3,8-11'̌`CPÜꗗǂށB
+inline vector<size_t> parseCpuList(const string &list) {
+    vector<size_t> cpus;
+    stringstream ss(list);
+    string range;
+    while (getline(ss, range, ',')) {
+        if (range.empty() || range[0] < '0' || range[0] > '9') 
+            continue;
+        size_t hyphen = range.find('-');
+        size_t first = stoul(range.substr(0, hyphen));
+        size_t last = hyphen == string::npos ? first : stoul(range.substr(hyphen + 1));
+        for (size_t c = first; c <= last; c++) 
+            cpus.push_back(c);
+    }
+    return cpus;
+}
+
+// m[hƂCPÜꗗBLinuxȊOƃm[hȂł͋B
+inline const vector<vector<size_t>> *getNumaNodes() {
+    static const vector<vector<size_t>> NUMA_NODES = []() {
+        vector<vector<size_t>> nodes;
+#ifdef __linux__
+        for (size_t n = 0; n < NUMA_MAX_NODES; n++) {
+            ifstream is("/sys/devices/system/node/node" + to_string(n) + "/cpulist");
+            if (!is) 
+                continue;
+            string list;
+            getline(is, list);
+            auto cpus = parseCpuList(list);
+            if (cpus.empty()) 
+                continue;
+            nodes.resize(n + 1);
+            nodes[n] = cpus;
+        }
+#endif
+        return nodes;
+    }();
+    return &NUMA_NODES;
+}
+
+// numaautoŁAm[h2ȏ゠ƂNUMAӎēB
+inline bool isNumaActive() {
+    size_t nodesNumber = 0;
+    for (auto &cpus : *getNumaNodes()) 
+        nodesNumber += cpus.empty() ? 0 : 1;
+    return *getNumaAware() && nodesNumber > 1;
+}
+
+inline size_t getNumaNodesNumber() {
+    return isNumaActive() ? getNumaNodes()->size() : 1;
+}
+
+// XbhŒ肷鏇CPUBm[hɏAXbhm[hɋϓɎU΂悤ɂB
+// ʂ2ȏȂAʂɃm[h֊蓖āAm[h̏ʂ͂̃m[hCPU𓙕B
+inline vector<NumaCpu> getNumaCpus() {
+    vector<NumaCpu> cpus;
+    if (!isNumaActive()) 
+        return cpus;
+    auto nodes = getNumaNodes();
+    auto rank = getNumaRank();
+    if (rank->ranksNumber > 1) {
+        vector<size_t> usedNodes;
+        for (size_t n = 0; n < nodes->size(); n++) {
+            if (!(*nodes)[n].empty()) 
+                usedNodes.push_back(n);
+        }
+        size_t node = usedNodes[rank->rank % usedNodes.size()];
+        size_t nodeRanksNumber = 
+            (rank->ranksNumber - rank->rank % usedNodes.size() + usedNodes.size() - 1) / usedNodes.size();
+        size_t nodeRank = rank->rank / usedNodes.size();
+        auto &nodeCpus = (*nodes)[node];
+        size_t first = nodeCpus.size() * nodeRank / nodeRanksNumber;
+        size_t last = max(nodeCpus.size() * (nodeRank + 1) / nodeRanksNumber, first + 1);
+        for (size_t i = first; i < last; i++) 
+            cpus.push_back({nodeCpus[i % nodeCpus.size()], node});
+        return cpus;
+    }
+    for (size_t i = 0;; i++) {
+        size_t added = 0;
+        for (size_t n = 0; n < nodes->size(); n++) {
+            if (i >= (*nodes)[n].size()) 
+                continue;
+            cpus.push_back({(*nodes)[n][i], n});
+            added++;
+        }
+        if (added == 0) 
+            break;
+    }
+    return cpus;
+}
+
+// ĂяoXbhŒ肳ꂽm[hBŒ肵ĂȂ0B
+inline size_t *getCurrentNumaNode() {
+    static thread_local size_t CURRENT_NUMA_NODE = 0;
+    return &CURRENT_NUMA_NODE;
+}
+
+// ĂяoXbhCPUɌŒ肷BŒłȂĂB
+inline void pinCurrentThread(const NumaCpu &cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu.cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+#endif
+    *getCurrentNumaNode() = cpu.node;
+}
+
+// m[hɒuzBLinuxł̓y[WmbindŃm[hɔĂŏɏށB
+// ȂĂʂ̃ƂĎgB
+class NodeLocalArray {
+protected:
+    PageMemory memory;
+public:
+    NodeLocalArray(const size_t &number, const size_t &node) : 
+        memory(number * sizeof(double)) 
+    {
+#ifdef __linux__
+        if (this->memory.getMappedSize() != 0) {
+            unsigned long nodeMask = 1UL << node;
+            syscall(SYS_mbind, this->memory.getData(), this->memory.getMappedSize(), NUMA_MPOL_BIND, &nodeMask, sizeof(nodeMask) * 8 + 1, 0);
+        }
+#endif
+    }
+    
+    double *getData() 
+        { return (double *)this->memory.getData(); }
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef PAGES_H
+#define PAGES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// 傫ȃy[W̑傫B
+constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+// y[WɒuȂƂɁAʂ̃ő鋫EB
+constexpr size_t PAGE_MEMORY_ALIGNMENT = 64;
+
+enum HugePagesPolicy {
+    NO_HUGE_PAGES, 
+    TRANSPARENT_HUGE_PAGES, 
+    HUGETLB_PAGES, 
+};
+
+inline const map<string, HugePagesPolicy> *getHugePagesPolicies() {
+    static const map<string, HugePagesPolicy> HUGE_PAGES_POLICIES = {
+        {"no",          NO_HUGE_PAGES}, 
+        {"transparent", TRANSPARENT_HUGE_PAGES}, 
+        {"hugetlb",     HUGETLB_PAGES}, 
+    };
+    return &HUGE_PAGES_POLICIES;
+}
+
+// hugePagesݒBf[^Zbgƃlbg[NOɌ߂B
+inline HugePagesPolicy *getHugePagesPolicy() {
+    static HugePagesPolicy HUGE_PAGES_POLICY = TRANSPARENT_HUGE_PAGES;
+    return &HUGE_PAGES_POLICY;
+}
+
+// 0ŏAy[Wɑ̈B
+// HUGE_PAGE_SIZEȏ̗̈́AhugePagesݒɏ]2MBɑđ傫ȃy[WɒuB
+// transparentȂmadviseŃJ[lɗ݁AhugetlbȂ\񂳂ꂽ傫ȃy[WB
+// hugetlbŎȂtransparentƓɂAʑłȂΕʂ̃gB
+class PageMemory {
+protected:
+    char               *data;
+    void               *mapped;
+    size_t              mappedSize;
+    unique_ptr<char[]>  buffer;
+    
+    static size_t alignUp(const size_t &size, const size_t &alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+    
+#ifdef __linux__
+    bool mapHugetlbPages(const size_t &size) {
+        size_t mappedSize = alignUp(size, HUGE_PAGE_SIZE);
+        void *p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) 
+            return false;
+        this->mapped = p;
+        this->mappedSize = mappedSize;
+        this->data = (char *)p;
+        return true;
+    }
+    
+    // 2MBɑ邽߂ɗ]ɎʑAO̗]B
+    bool mapTransparentHugePages(const size_t &size) {
+        size_t dataSize = alignUp(size, HUGE_PAGE_SIZE);
+        size_t mappedSize = dataSize + HUGE_PAGE_SIZE;
+        void *p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) 
+            return false;
+        char *begin = (char *)p;
+        char *data = (char *)alignUp((uintptr_t)begin, HUGE_PAGE_SIZE);
+        if (data != begin) 
+            munmap(begin, data - begin);
+        if (data + dataSize != begin + mappedSize) 
+            munmap(data + dataSize, begin + mappedSize - (data + dataSize));
+        madvise(data, dataSize, MADV_HUGEPAGE);
+        this->mapped = data;
+        this->mappedSize = dataSize;
+        this->data = data;
+        return true;
+    }
+    
+    bool mapPages(const size_t &size) {
+        size_t mappedSize = alignUp(size, sysconf(_SC_PAGESIZE));
+        void *p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) 
+            return false;
+        this->mapped = p;
+        this->mappedSize = mappedSize;
+        this->data = (char *)p;
+        return true;
+    }
+#endif
+public:
+    PageMemory(const size_t &size) : 
+        data      (nullptr), 
+        mapped    (nullptr), 
+        mappedSize(0) 
+    {
+        size_t pageMemorySize = max<size_t>(size, 1);
+#ifdef __linux__
+        auto policy = *getHugePagesPolicy();
+        if (pageMemorySize >= HUGE_PAGE_SIZE && 
+            policy == HUGETLB_PAGES && 
+            mapHugetlbPages(pageMemorySize)) 
+            return;
+        if (pageMemorySize >= HUGE_PAGE_SIZE && 
+            policy != NO_HUGE_PAGES && 
+            mapTransparentHugePages(pageMemorySize)) 
+            return;
+        if (mapPages(pageMemorySize)) 
+            return;
+#endif
+        this->buffer.reset(new char[pageMemorySize + PAGE_MEMORY_ALIGNMENT]());
+        this->data = this->buffer.get() + 
+            (PAGE_MEMORY_ALIGNMENT - (uintptr_t)this->buffer.get() % PAGE_MEMORY_ALIGNMENT) % PAGE_MEMORY_ALIGNMENT;
+    }
+    
+    PageMemory(const PageMemory &) = delete;
+    PageMemory &operator=(const PageMemory &) = delete;
+    
+    ~PageMemory() {
+#ifdef __linux__
+        if (this->mapped) 
+            munmap(this->mapped, this->mappedSize);
+#endif
+    }
+    
+    char *getData() 
+        { return this->data; }
+    // ʑ̈̑傫Bʂ̃Ȃ0B
+    size_t getMappedSize() 
+        { return this->mappedSize; }
+};
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// P̒iKB
+enum PerfPhase {
+    PERF_FORWARD, 
+    PERF_BACKWARD, 
+    PERF_UPDATE, 
+    PERF_EVAL, 
+    PERF_DATA, 
+    PERF_PHASES_NUMBER, 
+};
+
+// n[hEFÃJE^B
+enum PerfCounterType {
+    PERF_CYCLES, 
+    PERF_INSTRUCTIONS, 
+    PERF_L1D_MISSES, 
+    PERF_LLC_MISSES, 
+    PERF_DTLB_MISSES, 
+    PERF_COUNTERS_NUMBER, 
+};
+
+// perfCountersݒBXbhŏɃJE^gOɌ߂B
+inline bool *getPerfCountersEnabled() {
+    static bool PERF_COUNTERS_ENABLED = false;
+    return &PERF_COUNTERS_ENABLED;
+}
+
+// ĂяoXbh̃[U[Ԃ̃n[hEFÃJE^Bperf_event_open1̑gƂĊJB
+// JȂJE^0̂܂܂ɂA1JȂΐȂB
+// PMUg𑽏dƂ̂߂ɁAgLɂĂԂƎۂɐĂԂǂށB
+class PerfCounters {
+protected:
+    vector<int> fds;
+    int         indices[PERF_COUNTERS_NUMBER];
+    
+#ifdef __linux__
+    static uint64_t getCacheMissConfig(const uint64_t &cache) {
+        return 
+            cache | 
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) | 
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+    
+    void open(const PerfCounterType &counter, const uint32_t &type, const uint64_t &config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = 
+            PERF_FORMAT_GROUP | 
+            PERF_FORMAT_TOTAL_TIME_ENABLED | 
+            PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, this->fds.empty() ? -1 : this->fds[0], 0);
+        if (fd < 0) 
+            return;
+        this->indices[counter] = this->fds.size();
+        this->fds.push_back(fd);
+    }
+#endif
+    
+    PerfCounters() {
+        fill(this->indices, this->indices + PERF_COUNTERS_NUMBER, -1);
+        if (!*getPerfCountersEnabled()) 
+            return;
+#ifdef __linux__
+        open(PERF_CYCLES,       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(PERF_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(PERF_L1D_MISSES,   PERF_TYPE_HW_CACHE, getCacheMissConfig(PERF_COUNT_HW_CACHE_L1D));
+        open(PERF_LLC_MISSES,   PERF_TYPE_HW_CACHE, getCacheMissConfig(PERF_COUNT_HW_CACHE_LL));
+        open(PERF_DTLB_MISSES,  PERF_TYPE_HW_CACHE, getCacheMissConfig(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+    }
+public:
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+    
+    ~PerfCounters() {
+#ifdef __linux__
+        for (auto fd : this->fds) 
+            close(fd);
+#endif
+    }
+    
+    bool isOpen() 
+        { return !this->fds.empty(); }
+    
+    // JĂ̌vvaluesɁAgLɂĂԂƐĂ(imb)timesɓǂށB
+    // ǂ߂ȂΉȂB
+    void read(uint64_t *values, uint64_t *times) {
+#ifdef __linux__
+        uint64_t buffer[3 + PERF_COUNTERS_NUMBER];
+        ssize_t size = ::read(this->fds[0], buffer, sizeof(buffer));
+        if (size < (ssize_t)(3 * sizeof(uint64_t)) || buffer[0] != this->fds.size()) 
+            return;
+        times[0] = buffer[1];
+        times[1] = buffer[2];
+        for (size_t c = 0; c < PERF_COUNTERS_NUMBER; c++) 
+            values[c] = this->indices[c] < 0 ? 0 : buffer[3 + this->indices[c]];
+#endif
+    }
+    
+    static PerfCounters *getInstance() {
+        static thread_local PerfCounters INSTANCE;
+        return &INSTANCE;
+    }
+};
+
+// iKƂ̌vƁAgLɂĂԂƐĂԁB
+struct PerfCounts {
+    uint64_t values[PERF_PHASES_NUMBER][PERF_COUNTERS_NUMBER];
+    uint64_t enabledTimes[PERF_PHASES_NUMBER];
+    uint64_t runningTimes[PERF_PHASES_NUMBER];
+};
+
+// iǨvAg𐔂ĂԂ̊Ŋ߂scaledValuesɏB
+// gLɂĂ̂ɈxȂiḰAvȂ̂falseԂB
+inline bool scalePerfCounts(const PerfCounts &counts, const size_t &phase, uint64_t *scaledValues) {
+    uint64_t enabledTime = counts.enabledTimes[phase];
+    uint64_t runningTime = counts.runningTimes[phase];
+    if (enabledTime != 0 && runningTime == 0) 
+        return false;
+    for (size_t c = 0; c < PERF_COUNTERS_NUMBER; c++) {
+        scaledValues[c] = runningTime == enabledTime ? 
+            counts.values[phase][c] : 
+            (uint64_t)((double)counts.values[phase][c] * (double)enabledTime / (double)runningTime);
+    }
+    return true;
+}
+
+// iKς邽тɃJE^ǂ݁AO̓ǂ݂̍O̒iKɑB
+// 1̋L^͓1̃Xbh炵gȂBJE^JȂΉȂB
+class PerfRecorder {
+protected:
+    PerfCounts counts;
+    uint64_t   lastValues[PERF_COUNTERS_NUMBER];
+    uint64_t   lastTimes[2];
+    int        phase;
+    
+    void change(const int &phase) {
+        auto counters = PerfCounters::getInstance();
+        if (!counters->isOpen()) 
+            return;
+        uint64_t values[PERF_COUNTERS_NUMBER];
+        uint64_t times[2];
+        copy(this->lastValues, this->lastValues + PERF_COUNTERS_NUMBER, values);
+        copy(this->lastTimes, this->lastTimes + 2, times);
+        counters->read(values, times);
+        if (this->phase >= 0) {
+            for (size_t c = 0; c < PERF_COUNTERS_NUMBER; c++) 
+                this->counts.values[this->phase][c] += values[c] - this->lastValues[c];
+            this->counts.enabledTimes[this->phase] += times[0] - this->lastTimes[0];
+            this->counts.runningTimes[this->phase] += times[1] - this->lastTimes[1];
+        }
+        copy(values, values + PERF_COUNTERS_NUMBER, this->lastValues);
+        copy(times, times + 2, this->lastTimes);
+        this->phase = phase;
+    }
+public:
+    PerfRecorder() : 
+        counts    (), 
+        lastValues(), 
+        lastTimes (), 
+        phase     (-1) {}
+    
+    void enter(const PerfPhase &phase) 
+        { change(phase); }
+    void leave() 
+        { change(-1); }
+    
+    // iKƂ̌vԂ0ɖ߂B
+    PerfCounts take() {
+        PerfCounts counts = this->counts;
+        this->counts = {};
+        return counts;
+    }
+};
+
+#endif
@@ -0,0 +1,290 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "actfunc.h"
+#include "arena.h"
+#include "epilogue.h"
+#include "help.h"
+#include "layer.h"
+#include "mnist.h"
+#include "numa.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// w̓͂Xbhv[ŕɋ߂Ƃ́AƂ̍ŏ̐Ϙa̐B
+constexpr size_t PLAN_MIN_PARALLEL_MULTIPLY_ADDS = 1 << 16;
+
+// 0łȂd݂̊ȉ̑ẃAaȍsƂ0̏d݂΂ċ߂B
+constexpr double PLAN_MAX_SPARSE_DENSITY = 0.3;
+
+// _̎svBwƂ̏d݁AoCAXA֐ׁA2̃obt@Ɍ݂ɒuB
+// w̏o͎͂̑w̓͂߂͓ǂ܂Ȃ̂ŁȂw̏o͂̎̑w̓͂ŏ㏑łB
+// obt@̑傫͓͑w܂߂w̃j[̍ő̐B
+// _Ɏglbg[Nł́Ad݂ςrefreshŎ2蒼B
+// NUMAӎēȂAd݂m[hƂɎʂAsXbh̃m[h̎ʂǂށB
+// 0łȂd݂Ȃw͈ksi[(CSR)ɂāA0łȂd݂|B
+// ̉摜܂Ƃ߂Đ肷Ƃ́A摜Ƃׂ̊obt@ʂɎB
+class InferencePlan {
+protected:
+    struct Step {
+        size_t              sourceNeuronsNumber;
+        size_t              neuronsNumber;
+        const double       *weights;
+        const double       *biases;
+        ActivationFunction *activationFunction;
+        bool                sparse;
+        vector<uint32_t>    rowOffsets;
+        vector<uint32_t>    columns;
+        vector<double>      values;
+    };
+    
+    vector<Step>                                   steps;
+    size_t                                         bufferSize;
+    double                                        *buffers[2];
+    vector<double>                                 batchBuffers[2];
+    double                                        *outputs;
+    bool                                           inferenceOnly;
+    vector<vector<shared_ptr<NodeLocalArray>>>     replicas;
+    
+    // s̘̓͂a͖ȍsƓ͌̏ɑB0̏d݂̍΂Ăa͕ςȂB
+    void buildSparseStep(Step *s) {
+        size_t synapsesNumber = s->neuronsNumber * s->sourceNeuronsNumber;
+        size_t nonzerosNumber = synapsesNumber - count(s->weights, s->weights + synapsesNumber, 0.0);
+        s->sparse = (double)nonzerosNumber <= PLAN_MAX_SPARSE_DENSITY * (double)synapsesNumber;
+        s->rowOffsets.clear();
+        s->columns.clear();
+        s->values.clear();
+        if (!s->sparse) 
+            return;
+        s->rowOffsets.push_back(0);
+        for (size_t j = 0; j < s->neuronsNumber; j++) {
+            for (size_t i = 0; i < s->sourceNeuronsNumber; i++) {
+                double w = s->weights[j * s->sourceNeuronsNumber + i];
+                if (w == 0.0) 
+                    continue;
+                s->columns.push_back(i);
+                s->values.push_back(w);
+            }
+            s->rowOffsets.push_back(s->columns.size());
+        }
+    }
+    
+    const double *getWeights(const size_t &stepIndex) {
+        if (this->replicas.empty()) 
+            return this->steps[stepIndex].weights;
+        return this->replicas[*getCurrentNumaNode()][stepIndex]->getData();
+    }
+    
+    // bufferSizeƂɉ摜imagesNumberׂBd݂̍s͓ǂ񂾂SẲ摜Ɋ|B
+    void runDenseStep(
+        const size_t &stepIndex, 
+        const double *sources, 
+        double       *destinations, 
+        const size_t &imagesNumber) 
+    {
+        Step *s = &this->steps[stepIndex];
+        runInParallel(
+            s->neuronsNumber, 
+            max<size_t>(PLAN_MIN_PARALLEL_MULTIPLY_ADDS / (s->sourceNeuronsNumber * imagesNumber), 1), 
+            [this, s, stepIndex, sources, destinations, imagesNumber](const size_t &begin, const size_t &end) 
+        {
+            const double *stepWeights = getWeights(stepIndex);
+            for (auto j = begin; j < end; j++) {
+                const double *weights = stepWeights + j * s->sourceNeuronsNumber;
+                for (size_t n = 0; n < imagesNumber; n++) {
+                    const double *imageSources = sources + n * this->bufferSize;
+                    double input = 0.0;
+                    for (auto i = 0; i < s->sourceNeuronsNumber; i++) 
+                        input += weights[i] * imageSources[i];
+                    destinations[n * this->bufferSize + j] = input + s->biases[j];
+                }
+            }
+        });
+    }
+    
+    void runSparseStep(
+        Step         *s, 
+        const double *sources, 
+        double       *destinations, 
+        const size_t &imagesNumber) 
+    {
+        runInParallel(
+            s->neuronsNumber, 
+            max<size_t>(
+                PLAN_MIN_PARALLEL_MULTIPLY_ADDS * s->neuronsNumber / max<size_t>(s->values.size() * imagesNumber, 1), 
+                1), 
+            [this, s, sources, destinations, imagesNumber](const size_t &begin, const size_t &end) 
+        {
+            const uint32_t *rowOffsets = &s->rowOffsets[0];
+            const uint32_t *columns = s->columns.data();
+            const double *values = s->values.data();
+            for (auto j = begin; j < end; j++) {
+                for (size_t n = 0; n < imagesNumber; n++) {
+                    const double *imageSources = sources + n * this->bufferSize;
+                    double input = 0.0;
+                    for (auto k = rowOffsets[j]; k < rowOffsets[j + 1]; k++) 
+                        input += values[k] * imageSources[columns[k]];
+                    destinations[n * this->bufferSize + j] = input + s->biases[j];
+                }
+            }
+        });
+    }
+    
+    // sourcesɒu摜imagesNumber̓͂AŌ̑w̓͂destinationsɋ߂B
+    // Isources͍Ō̉Bw̏o͂uobt@wB
+    void runSteps(double **sources, double **destinations, const size_t &imagesNumber) {
+        for (auto s = this->steps.begin();; s++) {
+            TraceSpan span("forward", s - this->steps.begin() + 1);
+            if (s->sparse) 
+                runSparseStep(&*s, *sources, *destinations, imagesNumber);
+            else 
+                runDenseStep(s - this->steps.begin(), *sources, *destinations, imagesNumber);
+            if (s == this->steps.end() - 1) 
+                break;
+            for (size_t n = 0; n < imagesNumber; n++) {
+                double *imageDestinations = *destinations + n * this->bufferSize;
+                s->activationFunction->computeOutputs(imageDestinations, imageDestinations, s->neuronsNumber, nullptr);
+            }
+            swap(*sources, *destinations);
+        }
+    }
+    
+    static size_t computeBufferSize(vector<shared_ptr<Layer>> *layers) {
+        size_t bufferSize = 0;
+        for (auto l : *layers) 
+            bufferSize = max(bufferSize, l->getNeuronsNumber());
+        return bufferSize;
+    }
+public:
+    static size_t computeArenaSize(vector<shared_ptr<Layer>> *layers) {
+        return 2 * Arena::computeArraySize<double>(computeBufferSize(layers));
+    }
+    
+    // layers͏d݂ƃoCAXmۂČqłȂ΂ȂȂB
+    // inferenceOnlyłȂΏd݂͌Pŕς̂ŁAʂaȍsȂB
+    InferencePlan(
+        Arena                     *arena, 
+        vector<shared_ptr<Layer>> *layers, 
+        const bool                &inferenceOnly) : 
+            bufferSize   (computeBufferSize(layers)), 
+            outputs      (nullptr), 
+            inferenceOnly(inferenceOnly) 
+    {
+        this->buffers[0] = arena->allocateArray<double>(this->bufferSize);
+        this->buffers[1] = arena->allocateArray<double>(this->bufferSize);
+        this->steps.reserve(layers->size() - 1);
+        for (auto l = layers->begin() + 1; l != layers->end(); l++) {
+            auto notInputLayer = dynamic_cast<NotInputLayer *>(l->get());
+            auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+            if (!notInputLayer || !connectedLayer) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "_̎svȂwłB");
+            this->steps.push_back({
+                connectedLayer->getSourceNeuronsNumber(), 
+                (*l)->getNeuronsNumber(), 
+                connectedLayer->getWeights(), 
+                notInputLayer->getBiases(), 
+                notInputLayer->getActivationFunction(), 
+                false, 
+            });
+        }
+        if (!inferenceOnly) 
+            return;
+        if (isNumaActive()) {
+            this->replicas.resize(getNumaNodesNumber());
+            for (size_t n = 0; n < this->replicas.size(); n++) {
+                for (auto &s : this->steps) 
+                    this->replicas[n].push_back(make_shared<NodeLocalArray>(
+                        s.neuronsNumber * s.sourceNeuronsNumber, 
+                        n));
+            }
+        }
+        refresh();
+    }
+    
+    void refresh() {
+        if (!this->inferenceOnly) 
+            return;
+        for (auto &s : this->steps) 
+            buildSparseStep(&s);
+        for (auto &nodeReplicas : this->replicas) {
+            for (size_t i = 0; i < this->steps.size(); i++) 
+                copy(
+                    this->steps[i].weights, 
+                    this->steps[i].weights + this->steps[i].neuronsNumber * this->steps[i].sourceNeuronsNumber, 
+                    nodeReplicas[i]->getData());
+        }
+    }
+    
+    // Ō̑w̏o͂Ɠepilogueŋ߁ARXgcostsSumɑB
+    // ̘͂a͌P̏`dƓ͌̏ɑAŌɃoCAX𑫂B
+    // 傫ȑw͏o͐̃j[͈̔͂ɕĕɋ߂BĂʂ͕ςȂB
+    size_t run(
+        Image          *image, 
+        OutputEpilogue *epilogue, 
+        const size_t   &label, 
+        double         *costsSum) 
+    {
+        double *sources = this->buffers[0];
+        double *destinations = this->buffers[1];
+        auto intensities = image->getIntensities();
+        for (auto i = 0; i < IMAGE_AREA; i++) 
+            sources[i] = (double)intensities[i] / 255.0;
+        runSteps(&sources, &destinations, 1);
+        this->outputs = sources;
+        return epilogue->run(
+            destinations, 
+            sources, 
+            nullptr, 
+            this->steps.back().neuronsNumber, 
+            label, 
+            costsSum);
+    }
+    
+    // imagesNumber̉摜1xɐ肵AnԖڂ̉摜̓answers[n]ɁA
+    // o͑w̏o͂scoresn * LABEL_VALUES_NUMBERɏB
+    // d݂ǂމ񐔂͉摜̐ɂȂB摜Ƃ̌ʂrunƕςȂB
+    void runBatch(
+        Image *const   *images, 
+        const size_t   &imagesNumber, 
+        OutputEpilogue *epilogue, 
+        size_t         *answers, 
+        double         *scores) 
+    {
+        for (auto &b : this->batchBuffers) {
+            if (b.size() < imagesNumber * this->bufferSize) 
+                b.resize(imagesNumber * this->bufferSize);
+        }
+        double *sources = this->batchBuffers[0].data();
+        double *destinations = this->batchBuffers[1].data();
+        for (size_t n = 0; n < imagesNumber; n++) {
+            auto intensities = images[n]->getIntensities();
+            for (auto i = 0; i < IMAGE_AREA; i++) 
+                sources[n * this->bufferSize + i] = (double)intensities[i] / 255.0;
+        }
+        runSteps(&sources, &destinations, imagesNumber);
+        double costsSum = 0.0;
+        for (size_t n = 0; n < imagesNumber; n++) {
+            double *imageOutputs = sources + n * this->bufferSize;
+            answers[n] = epilogue->run(
+                destinations + n * this->bufferSize, 
+                imageOutputs, 
+                nullptr, 
+                this->steps.back().neuronsNumber, 
+                images[n]->getLabel(), 
+                &costsSum);
+            copy(imageOutputs, imageOutputs + LABEL_VALUES_NUMBER, scores + n * LABEL_VALUES_NUMBER);
+        }
+    }
+    
+    // Ōrun摜̏o͑w̏óB
+    const double *getOutputs() 
+        { return this->outputs; }
+};
+
+#endif
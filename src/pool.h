@@ -0,0 +1,284 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "numa.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// [J[Ƃ̃L[ɐς߂d̐Bꂽd͐ς񂾃Xbh̏ŎsB
+constexpr size_t THREAD_POOL_QUEUE_CAPACITY = 256;
+
+class TaskGroup;
+
+// Xbhv[̎dBruncontextƔ͈͂nB
+// dƂɃq[vmۂȂ悤ɁA֐IuWFNgł͂Ȃ֐ƃ|C^ŎB
+struct PoolTask {
+    void      (*run)(void *context, const size_t &begin, const size_t &end);
+    void       *context;
+    size_t      begin;
+    size_t      end;
+    TaskGroup  *group;
+};
+
+// d̑gBThreadPool::waitőg̎dSďÎ҂B
+class TaskGroup {
+protected:
+    atomic<size_t> pendingNumber;
+    
+    friend class ThreadPool;
+public:
+    TaskGroup() : pendingNumber(0) {}
+    
+    bool isDone() 
+        { return this->pendingNumber.load() == 0; }
+};
+
+// vZXŋL郏[NXeB[ÕXbhv[B
+// [J[͎̃L[̌납dAȂ瑼̃L[̑O瓐ށB
+// [J[łȂXbh̎d͋L̃L[ɐςށBd΃[J[͏ϐŖB
+// waitXbh͑҂Ăg̎dŎŝŁA[J[0łd͏IB
+class ThreadPool {
+protected:
+    // Œ蒷̗[L[B
+    class TaskQueue {
+    protected:
+        mutex            queueMutex;
+        vector<PoolTask> tasks;
+        size_t           head;
+        size_t           size;
+        
+        PoolTask &at(const size_t &index) 
+            { return this->tasks[(this->head + index) % this->tasks.size()]; }
+    public:
+        TaskQueue() : 
+            tasks(THREAD_POOL_QUEUE_CAPACITY), 
+            head (0), 
+            size (0) {}
+        
+        bool pushBack(const PoolTask &task) {
+            lock_guard<mutex> lock(this->queueMutex);
+            if (this->size == this->tasks.size()) 
+                return false;
+            at(this->size++) = task;
+            return true;
+        }
+        
+        bool popBack(PoolTask *task) {
+            lock_guard<mutex> lock(this->queueMutex);
+            if (this->size == 0) 
+                return false;
+            *task = at(--this->size);
+            return true;
+        }
+        
+        bool popFront(PoolTask *task) {
+            lock_guard<mutex> lock(this->queueMutex);
+            if (this->size == 0) 
+                return false;
+            *task = at(0);
+            this->head = (this->head + 1) % this->tasks.size();
+            this->size--;
+            return true;
+        }
+        
+        // group̎d납TĎoB
+        bool popGroup(TaskGroup *group, PoolTask *task) {
+            lock_guard<mutex> lock(this->queueMutex);
+            for (size_t i = this->size; i-- > 0;) {
+                if (at(i).group != group) 
+                    continue;
+                *task = at(i);
+                for (size_t j = i + 1; j < this->size; j++) 
+                    at(j - 1) = at(j);
+                this->size--;
+                return true;
+            }
+            return false;
+        }
+    };
+    
+    vector<shared_ptr<TaskQueue>> queues;
+    vector<NumaCpu>               cpus;
+    vector<thread>                workers;
+    vector<TraceBuffer *>         traceBuffers;
+    atomic<size_t>                queuedNumber;
+    mutex                         parkMutex;
+    condition_variable            parkCondition;
+    bool                          stopping;
+    
+    // [J[Ȃ玩̔ԍAłȂ΃[J[̐B
+    static size_t *getWorkerIndex() {
+        static thread_local size_t WORKER_INDEX = SIZE_MAX;
+        return &WORKER_INDEX;
+    }
+    
+    size_t getOwnQueueIndex() {
+        return min(*getWorkerIndex(), this->workers.size());
+    }
+    
+    void notify() {
+        { lock_guard<mutex> lock(this->parkMutex); }
+        this->parkCondition.notify_all();
+    }
+    
+    bool takeTask(PoolTask *task) {
+        size_t own = getOwnQueueIndex();
+        bool taken = this->queues[own]->popBack(task);
+        for (size_t i = 1; !taken && i < this->queues.size(); i++) 
+            taken = this->queues[(own + i) % this->queues.size()]->popFront(task);
+        if (taken) 
+            this->queuedNumber.fetch_sub(1);
+        return taken;
+    }
+    
+    bool takeGroupTask(TaskGroup *group, PoolTask *task) {
+        size_t own = getOwnQueueIndex();
+        bool taken = false;
+        for (size_t i = 0; !taken && i < this->queues.size(); i++) 
+            taken = this->queues[(own + i) % this->queues.size()]->popGroup(group, task);
+        if (taken) 
+            this->queuedNumber.fetch_sub(1);
+        return taken;
+    }
+    
+    void runTask(const PoolTask &task) {
+        {
+            TraceSpan span("task");
+            task.run(task.context, task.begin, task.end);
+        }
+        if (task.group->pendingNumber.fetch_sub(1) == 1) 
+            notify();
+    }
+    
+    // cpusłȂ΁AĂяoXbh̕ă[J[CPUɌŒ肷B
+    void work(const size_t &index) {
+        *getWorkerIndex() = index;
+        if (!this->traceBuffers.empty()) 
+            Tracer::getInstance()->setThreadBuffer(this->traceBuffers[index]);
+        if (!this->cpus.empty()) 
+            pinCurrentThread(this->cpus[(index + 1) % this->cpus.size()]);
+        for (;;) {
+            PoolTask task;
+            if (takeTask(&task)) {
+                runTask(task);
+                continue;
+            }
+            unique_lock<mutex> lock(this->parkMutex);
+            this->parkCondition.wait(lock, [this]() {
+                return this->stopping || this->queuedNumber.load() != 0;
+            });
+            if (this->stopping) 
+                break;
+        }
+    }
+public:
+    // ĂяoXbhd̂ŁA[J[threadsNumber - 1B
+    // g[XȂA[J[P̓rŊmۂȂ悤ɁAg[X̃obt@ŊmۂB
+    ThreadPool(const size_t &threadsNumber, const vector<NumaCpu> &cpus) : 
+        cpus        (cpus), 
+        queuedNumber(0), 
+        stopping    (false) 
+    {
+        size_t workersNumber = max<size_t>(threadsNumber, 1) - 1;
+        for (size_t i = 0; i < workersNumber + 1; i++) 
+            this->queues.push_back(make_shared<TaskQueue>());
+        for (size_t i = 0; *getTraceEnabled() && i < workersNumber; i++) 
+            this->traceBuffers.push_back(Tracer::getInstance()->addBuffer());
+        for (size_t i = 0; i < workersNumber; i++) 
+            this->workers.emplace_back(&ThreadPool::work, this, i);
+    }
+    
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(this->parkMutex);
+            this->stopping = true;
+        }
+        this->parkCondition.notify_all();
+        for (auto &w : this->workers) 
+            w.join();
+    }
+    
+    size_t getThreadsNumber() 
+        { return this->workers.size() + 1; }
+    
+    void submit(
+        TaskGroup    *group, 
+        void        (*run)(void *context, const size_t &begin, const size_t &end), 
+        void         *context, 
+        const size_t &begin, 
+        const size_t &end) 
+    {
+        PoolTask task = {run, context, begin, end, group};
+        group->pendingNumber.fetch_add(1);
+        this->queuedNumber.fetch_add(1);
+        if (!this->queues[getOwnQueueIndex()]->pushBack(task)) {
+            this->queuedNumber.fetch_sub(1);
+            runTask(task);
+            return;
+        }
+        notify();
+    }
+    
+    // group̎dSďI܂ŁAL[ɎcĂg̎dŎsȂ҂B
+    // g̎dwaitĂԑOɑSēȂ΂ȂȂB
+    void wait(TaskGroup *group) {
+        PoolTask task;
+        while (takeGroupTask(group, &task)) 
+            runTask(task);
+        unique_lock<mutex> lock(this->parkMutex);
+        this->parkCondition.wait(lock, [group]() {
+            return group->isDone();
+        });
+    }
+    
+    // [0, size)partsNumberɕĕɎsBŏ͌̕ĂяoXbhŎsB
+    template <typename Run> 
+    void parallelFor(
+        const size_t &size, 
+        const size_t &partsNumber, 
+        Run          &run) 
+    {
+        size_t partSize = (size + partsNumber - 1) / partsNumber;
+        TaskGroup group;
+        for (size_t begin = partSize; begin < size; begin += partSize) 
+            submit(
+                &group, 
+                [](void *context, const size_t &begin, const size_t &end) {
+                    (*(Run *)context)(begin, end);
+                }, 
+                &run, 
+                begin, 
+                min(begin + partSize, size));
+        run(0, min(partSize, size));
+        wait(&group);
+    }
+};
+
+// threadsݒ̃XbhB0Ȃn[hEFÃXbhBgetThreadPoolŏɌĂԑOɌ߂B
+inline size_t *getPoolThreadsNumber() {
+    static size_t POOL_THREADS_NUMBER = 0;
+    return &POOL_THREADS_NUMBER;
+}
+
+// getThreadPoolXbh̐B
+inline size_t countPoolThreads() {
+    return *getPoolThreadsNumber() != 0 ? 
+        *getPoolThreadsNumber() : 
+        max<size_t>(thread::hardware_concurrency(), 1);
+}
+
+inline ThreadPool *getThreadPool() {
+    static ThreadPool THREAD_POOL(countPoolThreads(), getNumaCpus());
+    return &THREAD_POOL;
+}
+
+#endif
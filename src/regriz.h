@@ -10,7 +10,51 @@
 
 using namespace std;
 
+// 4̕aɕāAZ̈ˑ̘Af؂B
+inline double sumAbsolutes(const double *values, const size_t &valuesNumber) {
+    double sums[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= valuesNumber; i += 4) {
+        sums[0] += fabs(values[i + 0]);
+        sums[1] += fabs(values[i + 1]);
+        sums[2] += fabs(values[i + 2]);
+        sums[3] += fabs(values[i + 3]);
+    }
+    for (; i < valuesNumber; i++) 
+        sums[0] += fabs(values[i]);
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+inline double sumSquares(const double *values, const size_t &valuesNumber) {
+    double sums[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= valuesNumber; i += 4) {
+        sums[0] += values[i + 0] * values[i + 0];
+        sums[1] += values[i + 1] * values[i + 1];
+        sums[2] += values[i + 2] * values[i + 2];
+        sums[3] += values[i + 3] * values[i + 3];
+    }
+    for (; i < valuesNumber; i++) 
+        sums[0] += values[i] * values[i];
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
 class Regularization {
+protected:
+    // Sڑ̑w̏d݂̔z񂲂Ƃsum̘a߂B
+    template <typename Sum> 
+    static double sumWeights(vector<shared_ptr<Layer>> *layers, Sum sum) {
+        double weightsSum = 0.0;
+        for (auto l = layers->begin() + 1; l != layers->end(); l++) {
+            auto connectedLayer = dynamic_cast<FullyConnectedLayer *>(l->get());
+            if (!connectedLayer) 
+                continue;
+            weightsSum += sum(
+                connectedLayer->getWeights(), 
+                connectedLayer->getNeuronsNumber() * connectedLayer->getSourceNeuronsNumber());
+        }
+        return weightsSum;
+    }
 public:
     virtual double computeWeightsCost(
         vector<shared_ptr<Layer>> *layers, 
@@ -42,14 +86,7 @@ public:
         vector<shared_ptr<Layer>> *layers, 
         const double              &weightDecayRate) override
     {
-        double absoluteWeightsSum = 0.0;
-        for (auto l = layers->begin() + 1; l != layers->end(); l++) {
-            for (auto n : (*(*l)->getNeurons())) {
-                for (auto s : *n->getInputSynapses()) 
-                    absoluteWeightsSum += fabs(s->getWeight());
-            }
-        }
-        return weightDecayRate * absoluteWeightsSum;
+        return weightDecayRate * sumWeights(layers, &sumAbsolutes);
     }
     
     virtual double computeDecayedWeight(
@@ -72,14 +109,7 @@ public:
         vector<shared_ptr<Layer>> *layers, 
         const double              &weightDecayRate) override
     {
-        double squaredWeightsSum = 0.0;
-        for (auto l = layers->begin() + 1; l != layers->end(); l++) {
-            for (auto n : (*(*l)->getNeurons())) {
-                for (auto s : *n->getInputSynapses()) 
-                    squaredWeightsSum += s->getWeight() * s->getWeight();
-            }
-        }
-        return 0.5 * weightDecayRate * squaredWeightsSum;
+        return 0.5 * weightDecayRate * sumWeights(layers, &sumSquares);
     }
     
     virtual double computeDecayedWeight(
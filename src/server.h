@@ -0,0 +1,364 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "help.h"
+#include "mnist.h"
+#include "network.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+constexpr size_t SERVE_RESPONSE_SIZE = 1 + LABEL_VALUES_NUMBER * sizeof(double);
+
+// v̒xW߂ĕSʐ߂B
+class LatencyStatistics {
+protected:
+    vector<double> latencies;
+    size_t         batchesNumber;
+    double         elapsedSeconds;
+public:
+    LatencyStatistics() : 
+        batchesNumber (0), 
+        elapsedSeconds(0.0) {}
+    size_t getRequestsNumber() 
+        { return this->latencies.size(); }
+    
+    void addBatch(const vector<double> &batchLatencies, const double &seconds) {
+        this->latencies.insert(this->latencies.end(), batchLatencies.begin(), batchLatencies.end());
+        this->batchesNumber++;
+        this->elapsedSeconds += seconds;
+    }
+    
+    void add(LatencyStatistics *statistics) {
+        this->latencies.insert(
+            this->latencies.end(), 
+            statistics->latencies.begin(), 
+            statistics->latencies.end());
+        this->batchesNumber  += statistics->batchesNumber;
+        this->elapsedSeconds += statistics->elapsedSeconds;
+    }
+    
+    void clear() {
+        this->latencies.clear();
+        this->batchesNumber = 0;
+        this->elapsedSeconds = 0.0;
+    }
+    
+    double computePercentile(const double &ratio) {
+        if (this->latencies.empty()) 
+            return 0.0;
+        size_t index = min(
+            this->latencies.size() - 1, 
+            (size_t)(ratio * (double)this->latencies.size()));
+        nth_element(this->latencies.begin(), this->latencies.begin() + index, this->latencies.end());
+        return this->latencies[index];
+    }
+    
+    void report(
+        const function<void(size_t, double, double, double, double, double)> &done, 
+        const double                                                         &wallSeconds) 
+    {
+        done(
+            this->latencies.size(), 
+            wallSeconds > 0.0 ? (double)this->latencies.size() / wallSeconds : 0.0, 
+            computePercentile(0.50), 
+            computePercentile(0.90), 
+            computePercentile(0.99), 
+            this->batchesNumber == 0 ? 0.0 : (double)this->latencies.size() / (double)this->batchesNumber);
+    }
+};
+
+#ifndef _WIN32
+
+// xǂݍ񂾃lbg[NUnixhC\Pbg̗̐vɓB
+// vIMAGE_AREAoCg̉摜ŁA1oCg̓Əo͑w̏o͂double̕сB
+// 肵ĂԂɓ͂vmaxBatchSize܂ŁAd݂1xǂނł܂Ƃ߂Đ肷B
+// maxBatchWait0łȂ΁Aŏ̗vmaxBatchWait܂Ŏ̗v҂B
+class InferenceServer {
+protected:
+    struct Connection {
+        int fd;
+        
+        Connection(const int &fd) : fd(fd) {}
+        ~Connection() 
+            { close(this->fd); }
+    };
+    
+    struct Request {
+        shared_ptr<Connection>           connection;
+        shared_ptr<Image>                image;
+        chrono::steady_clock::time_point receivedTime;
+    };
+    
+    Network                     *network;
+    shared_ptr<Log>              log;
+    string                       socketFile;
+    size_t                       maxBatchSize;
+    chrono::microseconds         maxBatchWait;
+    chrono::seconds              reportInterval;
+    size_t                       maxRequestsNumber;
+    mutex                        requestsMutex;
+    condition_variable           requestsCondition;
+    deque<Request>               requests;
+    size_t                       receivedRequestsNumber;
+    atomic<bool>                 stopping;
+    mutex                        connectionsMutex;
+    condition_variable           connectionsCondition;
+    vector<weak_ptr<Connection>> connections;
+    size_t                       receiversNumber;
+    
+    static atomic<bool> *getStopRequested() {
+        static atomic<bool> STOP_REQUESTED(false);
+        return &STOP_REQUESTED;
+    }
+    
+    static void requestStop(int signalNumber) {
+        getStopRequested()->store(true);
+    }
+    
+    void stop() {
+        this->stopping.store(true);
+        this->requestsCondition.notify_all();
+    }
+    
+    void receive(shared_ptr<Connection> connection) {
+        for (bool connected = true; connected;) {
+            auto image = newInstance<Image>(0);
+            size_t receivedSize = 0;
+            while (connected && receivedSize < IMAGE_AREA) {
+                ssize_t size = read(
+                    connection->fd, 
+                    image->getIntensities() + receivedSize, 
+                    IMAGE_AREA - receivedSize);
+                if (size <= 0) 
+                    connected = false;
+                else 
+                    receivedSize += size;
+            }
+            if (!connected) 
+                break;
+            unique_lock<mutex> lock(this->requestsMutex);
+            image->setIndex(this->receivedRequestsNumber++);
+            this->requests.push_back({connection, image, chrono::steady_clock::now()});
+            lock.unlock();
+            this->requestsCondition.notify_one();
+        }
+        lock_guard<mutex> lock(this->connectionsMutex);
+        this->receiversNumber--;
+        this->connectionsCondition.notify_all();
+    }
+    
+    void respond(Request *request, const size_t &answer, const double *scores) {
+        char response[SERVE_RESPONSE_SIZE];
+        response[0] = (char)answer;
+        memcpy(response + 1, scores, LABEL_VALUES_NUMBER * sizeof(double));
+        size_t sentSize = 0;
+        while (sentSize < SERVE_RESPONSE_SIZE) {
+            ssize_t size = send(
+                request->connection->fd, 
+                response + sentSize, 
+                SERVE_RESPONSE_SIZE - sentSize, 
+                MSG_NOSIGNAL);
+            if (size <= 0) 
+                return;
+            sentSize += size;
+        }
+    }
+    
+    void processBatches(LatencyStatistics *totalStatistics) {
+        LatencyStatistics intervalStatistics;
+        vector<Request> batch;
+        vector<Image *> batchImages;
+        vector<size_t> batchAnswers(this->maxBatchSize);
+        vector<double> batchScores(this->maxBatchSize * LABEL_VALUES_NUMBER);
+        vector<double> batchLatencies;
+        auto startTime = chrono::steady_clock::now();
+        auto intervalStartTime = startTime;
+        size_t servedRequestsNumber = 0;
+        for (;;) {
+            unique_lock<mutex> lock(this->requestsMutex);
+            this->requestsCondition.wait_for(lock, chrono::milliseconds(100), [this]() {
+                return !this->requests.empty() || this->stopping.load();
+            });
+            if (!this->requests.empty()) {
+                if (this->maxBatchWait.count() != 0) 
+                    this->requestsCondition.wait_until(
+                        lock, 
+                        this->requests.front().receivedTime + this->maxBatchWait, 
+                        [this]() {
+                            return this->requests.size() >= this->maxBatchSize || this->stopping.load();
+                        });
+                size_t batchSize = min(this->maxBatchSize, this->requests.size());
+                batch.assign(
+                    make_move_iterator(this->requests.begin()), 
+                    make_move_iterator(this->requests.begin() + batchSize));
+                this->requests.erase(this->requests.begin(), this->requests.begin() + batchSize);
+            } else if (this->stopping.load()) {
+                break;
+            }
+            lock.unlock();
+            
+            if (!batch.empty()) {
+                auto batchStartTime = chrono::steady_clock::now();
+                batchImages.clear();
+                for (auto &r : batch) 
+                    batchImages.push_back(r.image.get());
+                this->network->inferImages(
+                    batchImages.data(), 
+                    batch.size(), 
+                    batchAnswers.data(), 
+                    batchScores.data());
+                batchLatencies.clear();
+                for (size_t i = 0; i < batch.size(); i++) {
+                    respond(&batch[i], batchAnswers[i], &batchScores[i * LABEL_VALUES_NUMBER]);
+                    batchLatencies.push_back(chrono::duration<double, micro>(
+                        chrono::steady_clock::now() - batch[i].receivedTime).count());
+                }
+                intervalStatistics.addBatch(
+                    batchLatencies, 
+                    chrono::duration<double>(chrono::steady_clock::now() - batchStartTime).count());
+                servedRequestsNumber += batch.size();
+                batch.clear();
+                if (this->maxRequestsNumber != 0 && 
+                    servedRequestsNumber >= this->maxRequestsNumber) 
+                    stop();
+            }
+            
+            auto now = chrono::steady_clock::now();
+            if (this->reportInterval.count() != 0 && 
+                now - intervalStartTime >= this->reportInterval) 
+            {
+                if (intervalStatistics.getRequestsNumber() != 0) 
+                    intervalStatistics.report(
+                        this->log->doneServeInterval, 
+                        chrono::duration<double>(now - intervalStartTime).count());
+                totalStatistics->add(&intervalStatistics);
+                intervalStatistics.clear();
+                intervalStartTime = now;
+            }
+        }
+        totalStatistics->add(&intervalStatistics);
+        totalStatistics->report(
+            this->log->doneServe, 
+            chrono::duration<double>(chrono::steady_clock::now() - startTime).count());
+    }
+public:
+    InferenceServer(
+        Network                *network, 
+        const shared_ptr<Log>  &log, 
+        const string           &socketFile, 
+        const size_t           &maxBatchSize, 
+        const size_t           &maxBatchWait, 
+        const size_t           &reportInterval, 
+        const size_t           &maxRequestsNumber) : 
+            network               (network), 
+            log                   (log), 
+            socketFile            (socketFile), 
+            maxBatchSize          (maxBatchSize), 
+            maxBatchWait          (maxBatchWait), 
+            reportInterval        (reportInterval), 
+            maxRequestsNumber     (maxRequestsNumber), 
+            receivedRequestsNumber(0), 
+            stopping              (false), 
+            receiversNumber       (0) {}
+    
+    void run() {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (this->socketFile.size() >= sizeof(address.sun_path)) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "\Pbg̃t@C'", this->socketFile, "'܂B");
+        strcpy(address.sun_path, this->socketFile.c_str());
+        int listenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFD < 0) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "\Pbg܂B");
+        unlink(this->socketFile.c_str());
+        if (bind(listenFD, (sockaddr *)&address, sizeof(address)) != 0 || 
+            listen(listenFD, SOMAXCONN) != 0) 
+        {
+            close(listenFD);
+            throw describe(__FILE__, "(", __LINE__, "): " , "\Pbg'", this->socketFile, "'ő҂󂯂ł܂B");
+        }
+        signal(SIGINT,  &requestStop);
+        signal(SIGTERM, &requestStop);
+        
+        LatencyStatistics totalStatistics;
+        thread batchThread(&InferenceServer::processBatches, this, &totalStatistics);
+        while (!this->stopping.load()) {
+            if (getStopRequested()->load()) {
+                stop();
+                break;
+            }
+            pollfd listenPoll = {listenFD, POLLIN, 0};
+            if (poll(&listenPoll, 1, 100) <= 0) 
+                continue;
+            int fd = accept(listenFD, nullptr, nullptr);
+            if (fd < 0) 
+                continue;
+            auto connection = newInstance<Connection>(fd);
+            lock_guard<mutex> lock(this->connectionsMutex);
+            this->connections.erase(
+                remove_if(this->connections.begin(), this->connections.end(), [](
+                    const weak_ptr<Connection> &c) 
+                {
+                    return c.expired();
+                }), 
+                this->connections.end());
+            this->connections.push_back(connection);
+            this->receiversNumber++;
+            thread(&InferenceServer::receive, this, connection).detach();
+        }
+        close(listenFD);
+        unlink(this->socketFile.c_str());
+        
+        batchThread.join();
+        unique_lock<mutex> lock(this->connectionsMutex);
+        for (auto &c : this->connections) {
+            auto connection = c.lock();
+            if (connection) 
+                shutdown(connection->fd, SHUT_RDWR);
+        }
+        this->connectionsCondition.wait(lock, [this]() {
+            return this->receiversNumber == 0;
+        });
+    }
+};
+
+#else
+
+class InferenceServer {
+public:
+    InferenceServer(
+        Network                *network, 
+        const shared_ptr<Log>  &log, 
+        const string           &socketFile, 
+        const size_t           &maxBatchSize, 
+        const size_t           &maxBatchWait, 
+        const size_t           &reportInterval, 
+        const size_t           &maxRequestsNumber) {}
+    
+    void run() {
+        throw describe(__FILE__, "(", __LINE__, "): " , "̊łserve߂g܂B");
+    }
+};
+
+#endif
+
+#endif
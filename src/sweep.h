@@ -0,0 +1,134 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "help.h"
+#include <algorithm>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// lɂł؂̔fɗvAI̎s̍ŏB
+constexpr size_t SWEEP_PRUNE_MIN_TRIALS = 3;
+
+// sƂ̗̃Xg[̎n܂BXbhƂ̃Xg[ƏdȂȂ悤ɂB
+constexpr uint64_t SWEEP_RANDOM_STREAM = (uint64_t)1 << 32;
+
+using SweepTrial = vector<pair<string, string>>;
+
+// T͈̔́BsƂ'ݒ荀ږ l...'A󔒍s'#'Ŏn܂s͖B
+class SweepSpec {
+protected:
+    vector<pair<string, vector<string>>> dimensions;
+public:
+    SweepSpec(istream &is, const vector<string> &names) {
+        string line;
+        while (getLineAndChopCR(is, line)) {
+            if (line.empty() || 
+                line.at(0) == '#') 
+                continue;
+            vector<string> tokens;
+            tokenize(line, " \t", true, [&tokens](const string &token) {
+                tokens.push_back(token);
+            });
+            if (tokens.empty()) 
+                continue;
+            if (find(names.begin(), names.end(), tokens[0]) == names.end()) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "'", tokens[0], "'͒Tłݒ荀ڂł͂܂B");
+            if (tokens.size() < 2) 
+                throw describe(__FILE__, "(", __LINE__, "): " , "'", tokens[0], "'̒l܂B");
+            this->dimensions.push_back(make_pair(
+                tokens[0], 
+                vector<string>(tokens.begin() + 1, tokens.end())));
+        }
+        if (this->dimensions.empty()) 
+            throw describe(__FILE__, "(", __LINE__, "): " , "Tݒ荀ڂ܂B");
+    }
+    
+    // SĂ̒l̑gݍ킹AŌ̐ݒ荀ڂłς鏇ɕׂB
+    vector<SweepTrial> makeGridTrials() {
+        vector<SweepTrial> trials(1);
+        for (auto &d : this->dimensions) {
+            vector<SweepTrial> expandedTrials;
+            for (auto &t : trials) {
+                for (auto &v : d.second) {
+                    expandedTrials.push_back(t);
+                    expandedTrials.back().push_back(make_pair(d.first, v));
+                }
+            }
+            trials.swap(expandedTrials);
+        }
+        return trials;
+    }
+    
+    // ݒ荀ڂƂɒllɑI񂾑gtrialsNumberB
+    vector<SweepTrial> makeRandomTrials(const size_t &trialsNumber) {
+        vector<SweepTrial> trials(trialsNumber);
+        for (auto &t : trials) {
+            for (auto &d : this->dimensions) 
+                t.push_back(make_pair(
+                    d.first, 
+                    d.second[Random::getInstance()->uniformDistribution<size_t>(0, d.second.size() - 1)]));
+        }
+        return trials;
+    }
+};
+
+// ゲƂ̕]̐𐔂AI̎s̒lΑł؂B
+// pruneAfterOƁAׂ鎎sȂԂ͑ł؂ȂBpruneAfter0Ȃł؂ȂB
+class MedianPruner {
+protected:
+    size_t                          pruneAfter;
+    mutex                           valuesMutex;
+    map<size_t, vector<size_t>>     values;
+public:
+    MedianPruner(const size_t &pruneAfter) : 
+        pruneAfter(pruneAfter) {}
+    
+    bool report(const size_t &epochIndex, const size_t &value) {
+        lock_guard<mutex> lock(this->valuesMutex);
+        auto &epochValues = this->values[epochIndex];
+        bool prunes = false;
+        if (this->pruneAfter != 0 && 
+            epochIndex + 1 >= this->pruneAfter && 
+            epochValues.size() >= SWEEP_PRUNE_MIN_TRIALS) 
+        {
+            vector<size_t> sortedValues = epochValues;
+            auto median = sortedValues.begin() + sortedValues.size() / 2;
+            nth_element(sortedValues.begin(), median, sortedValues.end());
+            prunes = value < *median;
+        }
+        epochValues.push_back(value);
+        return prunes;
+    }
+};
+
+// w̎ނlayerType̍šsettingtBݒ荀ڂ͌ɏLɂȂB
+inline string appendLayerSetting(
+    const string &network, 
+    const string &layerType, 
+    const string &setting) 
+{
+    stringstream is(network);
+    string result;
+    string line;
+    while (getLineAndChopCR(is, line)) {
+        vector<string> tokens;
+        tokenize(line, " \t", true, [&tokens](const string &token) {
+            tokens.push_back(token);
+        });
+        result += line;
+        if (!tokens.empty() && 
+            tokens[0] == layerType) 
+            result += " " + setting;
+        result += "\n";
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// XbhƂ̃Oobt@ɎcԂ̐BꂽÂԂ㏑B
+constexpr size_t TRACE_BUFFER_CAPACITY = 1 << 16;
+
+// ԂɔԍƂ\lB
+constexpr size_t TRACE_NO_INDEX = SIZE_MAX;
+
+// traceFileݒ肪łȂǂBXbhv[OɌ߂B
+inline bool *getTraceEnabled() {
+    static bool TRACE_ENABLED = false;
+    return &TRACE_ENABLED;
+}
+
+// vZXŏɎǂł̃imbB
+inline int64_t getTraceTime() {
+    static const auto START = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - START).count();
+}
+
+// Ԃ̖O͕񃊃eŵŁAL^ƂɃq[vmۂȂB
+struct TraceEvent {
+    const char *name;
+    size_t      index;
+    int64_t     begin;
+    int64_t     end;
+};
+
+// 1̃XbhOobt@BŌɐi߂̂ŁAǂޑ͐܂łǂ߂B
+class TraceBuffer {
+protected:
+    vector<TraceEvent> events;
+    atomic<size_t>     eventsNumber;
+    size_t             threadIndex;
+public:
+    TraceBuffer(const size_t &threadIndex) : 
+        events      (TRACE_BUFFER_CAPACITY), 
+        eventsNumber(0), 
+        threadIndex (threadIndex) {}
+    
+    void put(const char *name, const size_t &index, const int64_t &begin, const int64_t &end) {
+        size_t number = this->eventsNumber.load(memory_order_relaxed);
+        this->events[number % TRACE_BUFFER_CAPACITY] = {name, index, begin, end};
+        this->eventsNumber.store(number + 1, memory_order_release);
+    }
+    
+    // ㏑ꂸɎcĂԂrunɓnB
+    template <typename Run> 
+    void forEach(Run run) {
+        size_t number = this->eventsNumber.load(memory_order_acquire);
+        size_t first = number > TRACE_BUFFER_CAPACITY ? number - TRACE_BUFFER_CAPACITY : 0;
+        for (size_t i = first; i < number; i++) 
+            run(this->events[i % TRACE_BUFFER_CAPACITY]);
+    }
+    
+    size_t getThreadIndex() 
+        { return this->threadIndex; }
+};
+
+// SẴXbh̃Oobt@Bobt@̓XbhIĂo܂ŎcB
+class Tracer {
+protected:
+    mutex                           buffersMutex;
+    vector<shared_ptr<TraceBuffer>> buffers;
+    size_t                          processIndex;
+    
+    Tracer() : processIndex(0) {}
+    
+    static TraceBuffer **getThreadBufferSlot() {
+        static thread_local TraceBuffer *THREAD_BUFFER = nullptr;
+        return &THREAD_BUFFER;
+    }
+public:
+    static Tracer *getInstance() {
+        static Tracer INSTANCE;
+        return &INSTANCE;
+    }
+    
+    TraceBuffer *addBuffer() {
+        lock_guard<mutex> lock(this->buffersMutex);
+        this->buffers.push_back(make_shared<TraceBuffer>(this->buffers.size()));
+        return this->buffers.back().get();
+    }
+    
+    // ĂяoXbh̃obt@BsetThreadBufferŌ߂ĂȂ΁AŏɌĂ񂾂ƂɊmۂB
+    // XbhtraceFileǂ񂾂ƂɍŏɌĂԂ̂ŁAԍ0ɂȂB
+    TraceBuffer *getThreadBuffer() {
+        auto slot = getThreadBufferSlot();
+        if (!*slot) 
+            *slot = addBuffer();
+        return *slot;
+    }
+    
+    void setThreadBuffer(TraceBuffer *buffer) 
+        { *getThreadBufferSlot() = buffer; }
+    
+    // UPforkvZX̏ʁBg[XpidɂB
+    size_t getProcessIndex() 
+        { return this->processIndex; }
+    void setProcessIndex(const size_t &processIndex) 
+        { this->processIndex = processIndex; }
+    
+    // Chrome/PerfettoTrace Event FormatŏBԂ͊CxgA̓}CNbB
+    // ĂԂɑ̃XbhL^Ȃ悤ɁASĂ̎dIĂĂԁB
+    void write(ostream &os) {
+        lock_guard<mutex> lock(this->buffersMutex);
+        os << fixed << setprecision(3) << "{\"traceEvents\":[";
+        const char *separator = "\n";
+        for (auto &b : this->buffers) {
+            string threadName = b->getThreadIndex() == 0 ? 
+                "main" : 
+                "thread " + to_string(b->getThreadIndex());
+            os << separator << 
+                "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << this->processIndex << 
+                ",\"tid\":" << b->getThreadIndex() << 
+                ",\"args\":{\"name\":\"" << threadName << "\"}}";
+            separator = ",\n";
+            b->forEach([this, &os, &b](const TraceEvent &e) {
+                os << ",\n{\"name\":\"" << e.name;
+                if (e.index != TRACE_NO_INDEX) 
+                    os << " " << e.index;
+                os << 
+                    "\",\"ph\":\"X\",\"pid\":" << this->processIndex << 
+                    ",\"tid\":" << b->getThreadIndex() << 
+                    ",\"ts\":" << (double)e.begin / 1000.0 << 
+                    ",\"dur\":" << (double)(e.end - e.begin) / 1000.0 << "}";
+            });
+        }
+        os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+};
+
+// Ăend܂͔j܂ł̋ԂĂяoXbh̃obt@ɋL^B
+// g[XȂƂ͎ǂ܂ȂB
+class TraceSpan {
+protected:
+    TraceBuffer *buffer;
+    const char  *name;
+    size_t       index;
+    int64_t      begin;
+public:
+    TraceSpan() : 
+        buffer(nullptr) {}
+    
+    TraceSpan(const char *name, const size_t &index = TRACE_NO_INDEX) : 
+        buffer(nullptr) 
+    {
+        start(name, index);
+    }
+    
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+    
+    ~TraceSpan() 
+        { end(); }
+    
+    void start(const char *name, const size_t &index = TRACE_NO_INDEX) {
+        end();
+        if (!*getTraceEnabled()) 
+            return;
+        this->buffer = Tracer::getInstance()->getThreadBuffer();
+        this->name   = name;
+        this->index  = index;
+        this->begin  = getTraceTime();
+    }
+    
+    void end() {
+        if (!this->buffer) 
+            return;
+        this->buffer->put(this->name, this->index, this->begin, getTraceTime());
+        this->buffer = nullptr;
+    }
+};
+
+#endif
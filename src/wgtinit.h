@@ -11,13 +11,22 @@ using namespace std;
 
 class WeightInitialization {
 public:
-    virtual double generateWeight(const size_t &inputsNumber) = 0;
+    virtual void generateWeights(
+        const size_t &inputsNumber, 
+        double       *weights, 
+        const size_t &weightsNumber) = 0;
 };
 
 class BroadInitialization : public WeightInitialization {
 public:
-    virtual double generateWeight(const size_t &inputsNumber) override {
-        return Random::getInstance()->normalDistribution<double>(
+    virtual void generateWeights(
+        const size_t &inputsNumber, 
+        double       *weights, 
+        const size_t &weightsNumber) override 
+    {
+        Random::getInstance()->fillNormalDistribution(
+            weights, 
+            weightsNumber, 
             0.0, 
             1.0);
     }
@@ -25,17 +34,40 @@ public:
 
 class NarrowInitialization : public WeightInitialization {
 public:
-    virtual double generateWeight(const size_t &inputsNumber) override {
-        return Random::getInstance()->normalDistribution<double>(
+    virtual void generateWeights(
+        const size_t &inputsNumber, 
+        double       *weights, 
+        const size_t &weightsNumber) override 
+    {
+        Random::getInstance()->fillNormalDistribution(
+            weights, 
+            weightsNumber, 
             0.0, 
             invert(sqrt(inputsNumber)));
     }
 };
 
+// HȅBReLUn̊֐őwd˂Ăo͂̕UۂB
+class HeInitialization : public WeightInitialization {
+public:
+    virtual void generateWeights(
+        const size_t &inputsNumber, 
+        double       *weights, 
+        const size_t &weightsNumber) override 
+    {
+        Random::getInstance()->fillNormalDistribution(
+            weights, 
+            weightsNumber, 
+            0.0, 
+            sqrt(2.0 / (double)inputsNumber));
+    }
+};
+
 inline const map<string, shared_ptr<WeightInitialization>> *getWeightInitializations() {
     static const map<string, shared_ptr<WeightInitialization>> WEIGHT_INITIALIZATIONS = {
         {"broad", newInstance<BroadInitialization>()}, 
         {"sharp", newInstance<NarrowInitialization>()}, 
+        {"he",    newInstance<HeInitialization>()}, 
     };
     return &WEIGHT_INITIALIZATIONS;
 }